@@ -0,0 +1,91 @@
+/**
+ * @file    block_parallel.hpp
+ * @brief   @copybrief chipimgproc::algo::BlockParallel
+ */
+#pragma once
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <vector>
+#include <Nucleona/parallel/thread_pool.hpp>
+namespace chipimgproc::algo {
+
+/**
+ * @brief Split the index range [0, n) into contiguous blocks and run each block
+ *        on its own worker thread.
+ *
+ * @details Each block is handed to the job functor as a half-open range
+ *          job(block_id, beg, end). Blocks never overlap, so jobs writing
+ *          to disjoint elements of a preallocated output need no locking.
+ *          With thread_num <= 1 the job is called once on the whole range
+ *          in the caller thread.
+ *
+ *          An exception thrown inside a job is captured and rethrown in the
+ *          caller thread after all blocks finished. When several blocks fail,
+ *          the exception of the lowest block is rethrown, which is the same
+ *          exception a serial row-major loop would have thrown.
+ */
+struct BlockParallel {
+    /**
+     * @brief Run job over [0, n) with at most thread_num blocks.
+     *
+     * @param n             Number of indices (e.g. rows of the probe grid).
+     * @param thread_num    Number of worker threads.
+     * @param job           Functor with symbol void(int block_id, int beg, int end).
+     */
+    template<class Job>
+    void operator()(int n, int thread_num, Job&& job) const {
+        if(n <= 0) return;
+        thread_num = std::min(thread_num, n);
+        if(thread_num <= 1) {
+            job(0, 0, n);
+            return;
+        }
+        auto blk_size = (n + thread_num - 1) / thread_num;
+        std::vector<std::exception_ptr> errors(thread_num);
+        {
+            auto thread_pool = nucleona::parallel::make_thread_pool(thread_num);
+            for(int t = 0; t < thread_num; t ++) {
+                int beg = t * blk_size;
+                int end = std::min(n, beg + blk_size);
+                if(beg >= end) break;
+                thread_pool.job_post([t, beg, end, &job, &errors](){
+                    try {
+                        job(t, beg, end);
+                    } catch(...) {
+                        errors[t] = std::current_exception();
+                    }
+                });
+            }
+            thread_pool.flush();
+        }
+        for(auto&& e : errors) {
+            if(e) std::rethrow_exception(e);
+        }
+    }
+};
+constexpr BlockParallel block_parallel;
+
+/**
+ * @brief A type erased block executor, runs job(block_id, beg, end) over
+ *        disjoint blocks covering [0, n) and returns after all blocks finished.
+ *
+ * @details Components taking a BlockExecutor can share one execution policy
+ *          (e.g. an application wide thread pool) instead of each creating
+ *          its own threads. Exceptions thrown by a job should be propagated
+ *          to the caller.
+ */
+using BlockExecutor = std::function<
+    void(int n, const std::function<void(int, int, int)>& job)
+>;
+
+/**
+ * @brief The default executor, block_parallel with thread_num threads.
+ */
+inline BlockExecutor make_block_executor(int thread_num) {
+    return [thread_num](int n, const std::function<void(int, int, int)>& job) {
+        block_parallel(n, thread_num, job);
+    };
+}
+
+}
@@ -0,0 +1,276 @@
+/**
+ * @file    fft_match_template.hpp
+ * @brief   @copybrief chipimgproc::algo::FFTMatchTemplate
+ */
+#pragma once
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <ChipImgProc/utils.h>
+#include <opencv2/imgproc.hpp>
+namespace chipimgproc::algo {
+
+/**
+ * @brief Template matching by FFT cross correlation with the template spectra cached.
+ *
+ * @details The frequency domain representation of the template (and of the mask) is
+ *          computed once per padded search size and kept, so matching an image of a
+ *          known size costs one forward FFT of the image (two with a mask, the image
+ *          and its square) and the inverse FFTs of the products. The marker detectors
+ *          match the same templates on every FOV, with a few fixed region sizes.
+ *
+ *          The results follow cv::matchTemplate:
+ *          - TM_CCORR:         sum(I * T * M^2)
+ *          - TM_CCORR_NORMED:  sum(I * T * M^2) / sqrt(sum(I^2 * M^2) * sum(T^2 * M^2)),
+ *                              without a mask the window energy is taken from an
+ *                              integral image, with the same rounding guards
+ *
+ *          As cv::matchTemplate does, an 8-bit mask is binary (any nonzero pixel
+ *          is 1), so a 0/255 mask does not scale the TM_CCORR scores, and the
+ *          interpolated borders of a rotated mask count fully. Masks of other
+ *          depths are used as weights.
+ *
+ *          The correlations are computed in double, as cv::matchTemplate does for
+ *          non 8-bit data, so the scores only differ by rounding.
+ *          Other modes and multi-channel images fall back to chipimgproc::match_template.
+ *
+ *          Copies share the spectra cache, and operator() is thread safe.
+ */
+struct FFTMatchTemplate {
+    FFTMatchTemplate() = default;
+    /**
+     * @param templ     The template, single channel.
+     * @param mask      The mask, same size as templ, empty for no mask.
+     * @param mode      The match mode.
+     */
+    FFTMatchTemplate(
+        cv::Mat                 templ,
+        cv::Mat                 mask = cv::Mat(),
+        cv::TemplateMatchModes  mode = cv::TM_CCORR_NORMED
+    )
+    : templ_    (std::move(templ))
+    , mask_     (std::move(mask))
+    , mode_     (mode)
+    , cache_    (std::make_shared<Cache>())
+    {
+        if(!mask_.empty() && mask_.size() != templ_.size()) {
+            throw std::invalid_argument("FFTMatchTemplate: mask size must equal the template size");
+        }
+        if(!supported()) return;
+        cv::Mat t;
+        templ_.convertTo(t, CV_64F);
+        if(!mask_.empty()) {
+            // same as cv::matchTemplate, an 8-bit mask is a binary mask
+            cv::Mat m;
+            if(mask_.depth() == CV_8U) {
+                cv::Mat bin = mask_ > 0;
+                bin.convertTo(m, CV_64F, 1.0 / 255);
+            } else {
+                mask_.convertTo(m, CV_64F);
+            }
+            m2_ = m.mul(m);
+            weighted_templ_ = t.mul(m2_);
+            templ_norm_ = std::sqrt(cv::sum(t.mul(t).mul(m2_))[0]);
+        } else {
+            weighted_templ_ = t;
+            templ_norm_ = std::sqrt(cv::sum(t.mul(t))[0]);
+        }
+    }
+    /**
+     * @brief Match the template on img, same result size and type as chipimgproc::match_template.
+     */
+    cv::Mat_<float> operator()(const cv::Mat& img) const {
+        if(!supported() || img.channels() != 1) {
+            return chipimgproc::match_template(
+                img, templ_, mode_,
+                mask_.empty() ? cv::noArray() : cv::_InputArray(mask_)
+            );
+        }
+        if(img.cols < templ_.cols || img.rows < templ_.rows) {
+            throw std::invalid_argument("FFTMatchTemplate: the image is smaller than the template");
+        }
+        const cv::Size corr_size(img.cols - templ_.cols + 1, img.rows - templ_.rows + 1);
+        const cv::Size dft_size(cv::getOptimalDFTSize(img.cols), cv::getOptimalDFTSize(img.rows));
+        auto spectra = get_spectra(dft_size);
+
+        cv::Mat src;
+        img.convertTo(src, CV_64F);
+        cv::Mat num = correlate(src, spectra->templ, dft_size, corr_size);
+
+        cv::Mat_<float> res;
+        if(mode_ == cv::TM_CCORR) {
+            num.convertTo(res, CV_32F);
+            return res;
+        }
+        if(!mask_.empty()) {
+            // same as the masked cv::matchTemplate: result /= sqrt(sum(I^2 * M^2)) * templ_norm
+            cv::Mat den = correlate(src.mul(src), spectra->m2, dft_size, corr_size);
+            cv::Mat_<float> den32;
+            num.convertTo(res, CV_32F);
+            den.convertTo(den32, CV_32F);
+            cv::sqrt(den32, den32);
+            den32 *= templ_norm_;
+            cv::divide(res, den32, res);
+            return res;
+        }
+        // same as the unmasked cv::matchTemplate: window energy by the integral image
+        cv::Mat sum, sqsum;
+        cv::integral(src, sum, sqsum, CV_64F, CV_64F);
+        res.create(corr_size);
+        for(int r = 0; r < corr_size.height; r ++) {
+            auto* q0 = sqsum.ptr<double>(r);
+            auto* q1 = sqsum.ptr<double>(r + templ_.rows);
+            auto* n  = num.ptr<double>(r);
+            auto* o  = res.ptr<float>(r);
+            for(int c = 0; c < corr_size.width; c ++) {
+                double wnd_sum2 = q1[c + templ_.cols] - q1[c] - q0[c + templ_.cols] + q0[c];
+                double diff2 = std::max(wnd_sum2, 0.0);
+                double t = diff2 <= std::min(0.5, 10 * FLT_EPSILON * wnd_sum2)
+                    ? 0 : std::sqrt(diff2) * templ_norm_;
+                double v = n[c];
+                if(std::abs(v) < t) {
+                    v /= t;
+                } else if(std::abs(v) < t * 1.125) {
+                    v = v > 0 ? 1 : -1;
+                } else {
+                    v = 0;
+                }
+                o[c] = v;
+            }
+        }
+        return res;
+    }
+    const cv::Mat& templ() const { return templ_; }
+    const cv::Mat& mask() const { return mask_; }
+    cv::TemplateMatchModes mode() const { return mode_; }
+    /**
+     * @brief The number of cached padded search sizes.
+     */
+    std::size_t cached_sizes() const {
+        if(!cache_) return 0;
+        std::lock_guard<std::mutex> lock(cache_->mux);
+        return cache_->spectra.size();
+    }
+private:
+    struct Spectra {
+        cv::Mat templ;  ///< spectrum of T * M^2, CCS packed
+        cv::Mat m2;     ///< spectrum of M^2, CCS packed, empty without mask
+    };
+    struct Cache {
+        std::mutex                                                      mux     ;
+        std::map<std::pair<int, int>, std::shared_ptr<const Spectra>>   spectra ;
+    };
+    bool supported() const {
+        return (mode_ == cv::TM_CCORR || mode_ == cv::TM_CCORR_NORMED)
+            && templ_.channels() == 1
+            && (mask_.empty() || mask_.channels() == 1);
+    }
+    static cv::Mat forward(const cv::Mat& m, const cv::Size& dft_size) {
+        cv::Mat padded = cv::Mat::zeros(dft_size, CV_64F);
+        m.copyTo(padded(cv::Rect(0, 0, m.cols, m.rows)));
+        cv::Mat spectrum;
+        cv::dft(padded, spectrum, 0, m.rows);
+        return spectrum;
+    }
+    static cv::Mat correlate(
+        const cv::Mat& src, const cv::Mat& kernel_spectrum,
+        const cv::Size& dft_size, const cv::Size& corr_size
+    ) {
+        cv::Mat prod, corr;
+        cv::mulSpectrums(forward(src, dft_size), kernel_spectrum, prod, 0, true);
+        cv::dft(prod, corr, cv::DFT_INVERSE | cv::DFT_SCALE | cv::DFT_REAL_OUTPUT, corr_size.height);
+        return corr(cv::Rect(0, 0, corr_size.width, corr_size.height));
+    }
+    std::shared_ptr<const Spectra> get_spectra(const cv::Size& dft_size) const {
+        auto key = std::make_pair(dft_size.width, dft_size.height);
+        {
+            std::lock_guard<std::mutex> lock(cache_->mux);
+            auto itr = cache_->spectra.find(key);
+            if(itr != cache_->spectra.end()) return itr->second;
+        }
+        auto spectra = std::make_shared<Spectra>();
+        spectra->templ = forward(weighted_templ_, dft_size);
+        if(!m2_.empty()) {
+            spectra->m2 = forward(m2_, dft_size);
+        }
+        std::lock_guard<std::mutex> lock(cache_->mux);
+        return cache_->spectra.emplace(key, std::move(spectra)).first->second;
+    }
+
+    cv::Mat                     templ_          ;
+    cv::Mat                     mask_           ;
+    cv::TemplateMatchModes      mode_           {cv::TM_CCORR_NORMED};
+    cv::Mat                     weighted_templ_ ;
+    cv::Mat                     m2_             ;
+    double                      templ_norm_     {0};
+    std::shared_ptr<Cache>      cache_          ;
+};
+
+/**
+ * @brief The FFT matchers of the templates matched on every FOV, kept across calls.
+ *
+ * @details The key is the identity of the source template and mask (their data
+ *          pointers and size) and a tag, e.g. the rotation angle applied to them.
+ *          An entry keeps a reference of its source matrices, so their buffers
+ *          cannot be reused by other matrices while cached. A template modified
+ *          in place is not detected, clear() the cache after that.
+ *
+ *          The returned matchers share the spectra cache of the entry. Thread safe.
+ */
+struct FFTMatchTemplateCache {
+    /**
+     * @brief Find the matcher of the key, or create it by make().
+     *
+     * @param templ     The source template of the key.
+     * @param mask      The source mask of the key, can be empty.
+     * @param tag       The key tag.
+     * @param make      Create the matcher, only called on a miss.
+     */
+    template<class MAKE>
+    FFTMatchTemplate get(
+        const cv::Mat&  templ,
+        const cv::Mat&  mask,
+        double          tag,
+        MAKE&&          make
+    ) {
+        auto key = std::make_tuple(
+            templ.data, mask.data, templ.rows, templ.cols, tag
+        );
+        {
+            std::lock_guard<std::mutex> lock(mux_);
+            auto itr = entries_.find(key);
+            if(itr != entries_.end()) return itr->second.match;
+        }
+        Entry entry{templ, mask, make()};
+        std::lock_guard<std::mutex> lock(mux_);
+        return entries_.emplace(key, std::move(entry)).first->second.match;
+    }
+    /**
+     * @brief The number of cached matchers.
+     */
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(mux_);
+        return entries_.size();
+    }
+    void clear() {
+        std::lock_guard<std::mutex> lock(mux_);
+        entries_.clear();
+    }
+private:
+    using Key = std::tuple<const uchar*, const uchar*, int, int, double>;
+    struct Entry {
+        cv::Mat             templ   ;
+        cv::Mat             mask    ;
+        FFTMatchTemplate    match   ;
+    };
+    std::map<Key, Entry>    entries_    ;
+    mutable std::mutex      mux_        ;
+};
+
+}
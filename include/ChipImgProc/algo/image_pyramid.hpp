@@ -0,0 +1,124 @@
+/**
+ * @file    image_pyramid.hpp
+ * @brief   @copybrief chipimgproc::algo::ImagePyramid
+ */
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+namespace chipimgproc::algo {
+
+/**
+ * @brief The u8-normalized cv::pyrDown pyramid of a FOV, computed once and shared by
+ *        the marker detectors.
+ *
+ * @details Level 0 is the input converted to CV_8U (16-bit images are scaled by
+ *          255 / theor_max_val) and preprocessed, level i is cv::pyrDown of level i - 1.
+ *          Each level is computed exactly once at construction, so the detectors
+ *          taking an ImagePyramid (e.g. marker::detection::RandomBased, FusionArray,
+ *          ArucoRegMat and ScaledMatchTemplate) do not downsample the FOV again.
+ *
+ *          The levels are read only after construction, copies share them and
+ *          the object can be used by multiple threads.
+ */
+struct ImagePyramid {
+    using Preprocessor = std::function<
+        cv::Mat_<std::uint8_t>(const cv::Mat_<std::uint8_t>&)
+    >;
+    ImagePyramid() = default;
+    /**
+     * @param input         The FOV image, CV_8U or CV_16U.
+     * @param levels        The number of pyrDown levels, the pyramid has levels + 1 images.
+     * @param theor_max_val The theoretical maximum value of a 16-bit input.
+     * @param preprocess    The preprocessor applied on level 0 before downsampling,
+     *                      nullptr for none.
+     */
+    ImagePyramid(
+        const cv::Mat&  input,
+        int             levels,
+        double          theor_max_val   = 16383,
+        Preprocessor    preprocess      = nullptr
+    ) {
+        if(levels < 0) {
+            throw std::invalid_argument("ImagePyramid: negative pyramid levels");
+        }
+        levels_.reserve(levels + 1);
+        auto base = to_u8(input, theor_max_val);
+        if(preprocess) {
+            base = preprocess(base);
+        }
+        levels_.push_back(base);
+        for(int i = 1; i <= levels; i ++) {
+            cv::Mat_<std::uint8_t> down;
+            cv::pyrDown(levels_.back(), down);
+            levels_.push_back(down);
+        }
+    }
+    /**
+     * @brief Convert a CV_8U or CV_16U image to CV_8U, the same conversion as the
+     *        marker detectors. A CV_8U input is copied.
+     */
+    static cv::Mat_<std::uint8_t> to_u8(const cv::Mat& input, double theor_max_val) {
+        cv::Mat_<std::uint8_t> image;
+        if (input.depth() == CV_8U)
+            input.copyTo(image);
+        else if (input.depth() == CV_16U)
+            input.convertTo(image, CV_8U, 255.0 / theor_max_val);
+        else
+            throw std::invalid_argument("Invalid input format");
+        return image;
+    }
+    /**
+     * @brief The defect fix of the white channel images, raise all pixels to the mean.
+     */
+    static cv::Mat_<std::uint8_t> clip_to_mean(const cv::Mat_<std::uint8_t>& mat) {
+        return cv::max(mat, cv::mean(mat)[0]);
+    }
+    /**
+     * @brief The number of pyrDown levels.
+     */
+    int levels() const {
+        return static_cast<int>(levels_.size()) - 1;
+    }
+    bool empty() const {
+        return levels_.empty();
+    }
+    /**
+     * @brief The i-th level, level 0 is the normalized input.
+     */
+    const cv::Mat_<std::uint8_t>& level(int i) const {
+        if(i < 0 || i >= static_cast<int>(levels_.size())) {
+            throw std::out_of_range(
+                "ImagePyramid: level " + std::to_string(i) + " not computed"
+            );
+        }
+        return levels_[i];
+    }
+    /**
+     * @brief The rectangle of the i-th level covering roi, a level 0 rectangle.
+     */
+    cv::Rect region_rect(int i, const cv::Rect& roi) const {
+        auto& mat = level(i);
+        const int s = 1 << i;
+        int x0 = cvFloor(roi.x / static_cast<double>(s));
+        int y0 = cvFloor(roi.y / static_cast<double>(s));
+        int x1 = cvCeil((roi.x + roi.width ) / static_cast<double>(s));
+        int y1 = cvCeil((roi.y + roi.height) / static_cast<double>(s));
+        return cv::Rect(x0, y0, x1 - x0, y1 - y0) & cv::Rect(0, 0, mat.cols, mat.rows);
+    }
+    /**
+     * @brief The view of the i-th level covering roi, a level 0 rectangle.
+     *        The view shares the level data.
+     */
+    cv::Mat_<std::uint8_t> region(int i, const cv::Rect& roi) const {
+        return level(i)(region_rect(i, roi));
+    }
+private:
+    std::vector<cv::Mat_<std::uint8_t>> levels_;
+};
+
+}
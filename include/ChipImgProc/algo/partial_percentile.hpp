@@ -2,7 +2,10 @@
 #include <numeric>
 #include <vector>
 #include <stdexcept>
+#include <memory>
+#include <type_traits>
 #include <opencv2/core.hpp>
+#include <ChipImgProc/algo/u16_histogram.hpp>
 
 //TODO add comments
 namespace chipimgproc {
@@ -40,28 +43,48 @@ class PartialPercentile {
     template <class CONTAINER, class SELECTOR>
     double calculate(CONTAINER&& values, const double q, SELECTOR&& indices) {
         double result;
-        if (indices.size() > 0) {
-            auto n = indices.size() - 1;
-            auto f = q * n;
-            auto i = static_cast<int32_t>(f);
-            for (auto j = i; j <= i + (i != n); ++j) {
-                std::nth_element(
-                    indices.begin()
-                  , indices.begin() + j
-                  , indices.end()
-                  , [&values](auto&& lhs, auto&& rhs) {
-                        return values(lhs) < values(rhs);
-                    }
-                );
-                if (j == i)
-                    result = values(indices[j]);
-                else
-                    result += (values(indices[j]) - result) * (f - i);
+        if constexpr (std::is_same_v<T, std::uint16_t>) {
+            // exact order statistics by a histogram, the indices are left untouched
+            if (indices.size() > 0) {
+                if (!hist_) hist_ = std::make_unique<algo::U16Histogram>();
+                hist_->clear();
+                for (auto&& idx : indices)
+                    hist_->add(values(idx));
+                auto n = indices.size() - 1;
+                auto f = q * n;
+                auto i = static_cast<int32_t>(f);
+                result = hist_->select(i);
+                if (i != n)
+                    result += (hist_->select(i + 1) - result) * (f - i);
+                return result;
+            } else {
+                throw std::length_error("indices.size() < 1");
             }
         } else {
-            throw std::length_error("indices.size() < 1");
+            if (indices.size() > 0) {
+                auto n = indices.size() - 1;
+                auto f = q * n;
+                auto i = static_cast<int32_t>(f);
+                for (auto j = i; j <= i + (i != n); ++j) {
+                    std::nth_element(
+                        indices.begin()
+                      , indices.begin() + j
+                      , indices.end()
+                      , [&values](auto&& lhs, auto&& rhs) {
+                            return values(lhs) < values(rhs);
+                        }
+                    );
+                    if (j == i)
+                        result = values(indices[j]);
+                    else
+                        result += (values(indices[j]) - result) * (f - i);
+                }
+            } else {
+                throw std::length_error("indices.size() < 1");
+            }
         }
         return result;
     }
+    std::unique_ptr<algo::U16Histogram> hist_;
 };
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include <ChipImgProc/utils.h>
+#include <ChipImgProc/algo/image_pyramid.hpp>
 #include <opencv2/opencv.hpp>
 namespace chipimgproc::algo {
 
@@ -12,26 +13,45 @@ constexpr struct ScaledMatchTemplate {
         int py_down_times = 1,
         cv::Mat mask = cv::Mat()
     ) const {
-        cv::Mat stgt;
-        cv::Mat stpl;
-        cv::Mat smask;
-
-        cv::Mat tmp = tgt.clone();
-        for(int i = 0; i < py_down_times; i ++ ) {
-            cv::pyrDown(tmp, stgt);
-            tmp = stgt.clone();
-        }
-        tmp = tpl.clone();
+        max(tgt, down(tgt, py_down_times), tpl, score, method, py_down_times, mask);
+    }
+    /**
+     * @brief Same as the image version, with the target downsampled by a shared
+     *        FOV pyramid. The template must be CV_8U like the pyramid levels.
+     */
+    void max(
+        const ImagePyramid& tgt, 
+        cv::Mat tpl, 
+        cv::Mat& score, 
+        int method = CV_TM_CCORR_NORMED, 
+        int py_down_times = 1,
+        cv::Mat mask = cv::Mat()
+    ) const {
+        max(tgt.level(0), tgt.level(py_down_times), tpl, score, method, py_down_times, mask);
+    }
+private:
+    static cv::Mat down(const cv::Mat& mat, int py_down_times) {
+        cv::Mat res = mat;
         for(int i = 0; i < py_down_times; i ++ ) {
-            cv::pyrDown(tmp, stpl);
-            tmp = stpl.clone();
+            cv::Mat tmp;
+            cv::pyrDown(res, tmp);
+            res = tmp;
         }
+        return res;
+    }
+    void max(
+        cv::Mat tgt, 
+        cv::Mat stgt, 
+        cv::Mat tpl, 
+        cv::Mat& score, 
+        int method,
+        int py_down_times,
+        cv::Mat mask
+    ) const {
+        cv::Mat stpl = down(tpl, py_down_times);
+        cv::Mat smask;
         if(!mask.empty()) {
-            tmp = mask.clone();
-            for(int i = 0; i < py_down_times; i ++ ) {
-                cv::pyrDown(tmp, smask);
-                tmp = smask.clone();
-            }
+            smask = down(mask, py_down_times);
         }
         cv::Mat_<float> sscore(
             stgt.rows - stpl.rows + 1,
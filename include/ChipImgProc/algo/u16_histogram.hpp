@@ -0,0 +1,143 @@
+/**
+ * @file    u16_histogram.hpp
+ * @brief   @copybrief chipimgproc::algo::U16Histogram
+ */
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <opencv2/core.hpp>
+namespace chipimgproc::algo {
+
+/**
+ * @brief Exact order statistics of 16-bit values by a two-level 256 x 256 histogram.
+ *
+ * @details The values are counted in 65536 fine bins and 256 coarse bins (the
+ *          high byte), so the k-th smallest value is found by scanning at most
+ *          256 coarse bins and 256 fine bins after one linear counting pass,
+ *          instead of sorting or partitioning a copy of the data.
+ *          The coarse bins also keep the sum of their values, which gives the
+ *          exact sum of the k smallest values (e.g. for a trimmed mean).
+ *
+ *          clear() only resets the fine bins of the non-empty coarse bins, so
+ *          an object can be reused for many small inputs (e.g. probe tiles)
+ *          without paying for the whole 65536 bins each time. The object is
+ *          not thread safe, use one per thread.
+ */
+struct U16Histogram {
+    U16Histogram()
+    : fine_(65536, 0)
+    {
+        coarse_.fill(0);
+        coarse_sum_.fill(0);
+    }
+    void add(std::uint16_t v) {
+        fine_[v] ++;
+        coarse_[v >> 8] ++;
+        coarse_sum_[v >> 8] += v;
+        total_ ++;
+    }
+    /**
+     * @brief Count all pixels of a CV_16U image.
+     */
+    void add(const cv::Mat& mat) {
+        if(mat.depth() != CV_16U || mat.channels() != 1) {
+            throw std::invalid_argument("U16Histogram: the image must be CV_16UC1");
+        }
+        for(int r = 0; r < mat.rows; r ++) {
+            auto* p = mat.ptr<std::uint16_t>(r);
+            for(int c = 0; c < mat.cols; c ++) {
+                add(p[c]);
+            }
+        }
+    }
+    /**
+     * @brief Count all values of a range.
+     */
+    template<class Rng>
+    void add_range(const Rng& rng) {
+        for(auto&& v : rng) {
+            add(v);
+        }
+    }
+    void clear() {
+        for(std::size_t b = 0; b < coarse_.size(); b ++) {
+            if(coarse_[b] == 0) continue;
+            std::fill(fine_.begin() + (b << 8), fine_.begin() + ((b + 1) << 8), 0);
+        }
+        coarse_.fill(0);
+        coarse_sum_.fill(0);
+        total_ = 0;
+    }
+    std::size_t size() const {
+        return total_;
+    }
+    /**
+     * @brief The k-th (0-based) smallest value, same as the value at position k
+     *        after sorting the input.
+     */
+    std::uint16_t select(std::size_t k) const {
+        if(k >= total_) {
+            throw std::out_of_range("U16Histogram: select index out of range");
+        }
+        std::size_t b = 0;
+        while(k >= coarse_[b]) {
+            k -= coarse_[b];
+            b ++;
+        }
+        std::size_t v = b << 8;
+        while(k >= fine_[v]) {
+            k -= fine_[v];
+            v ++;
+        }
+        return static_cast<std::uint16_t>(v);
+    }
+    /**
+     * @brief The exact sum of the k smallest values.
+     */
+    std::uint64_t prefix_sum(std::size_t k) const {
+        if(k > total_) {
+            throw std::out_of_range("U16Histogram: prefix sum index out of range");
+        }
+        std::uint64_t sum = 0;
+        std::size_t b = 0;
+        while(b < coarse_.size() && k >= coarse_[b]) {
+            k   -= coarse_[b];
+            sum += coarse_sum_[b];
+            b ++;
+        }
+        for(std::size_t v = b << 8; k > 0; v ++) {
+            auto n = std::min<std::size_t>(k, fine_[v]);
+            sum += static_cast<std::uint64_t>(n) * v;
+            k   -= n;
+        }
+        return sum;
+    }
+    /**
+     * @brief The linear interpolated percentile, p in [0, 100], same definition
+     *        as chipimgproc::utils::percentile.
+     */
+    double percentile(double p) const {
+        const double int_margin = 0.00001;
+        if(total_ == 0) {
+            throw std::length_error("U16Histogram: empty histogram");
+        }
+        auto i = (total_ - 1) * p * 0.01;
+        std::size_t i_floor = static_cast<std::size_t>(i);
+        auto tmp = i - i_floor;
+        double a = select(i_floor);
+        if(tmp < int_margin) return a;
+        double b = select(std::min(i_floor + 1, total_ - 1));
+        if(tmp > (1.0 - int_margin)) return b;
+        return a + ((b - a) * tmp);
+    }
+private:
+    std::vector<std::uint32_t>          fine_       ;
+    std::array<std::uint32_t, 256>      coarse_     ;
+    std::array<std::uint64_t, 256>      coarse_sum_ ;
+    std::size_t                         total_      {0};
+};
+
+}
@@ -75,6 +75,7 @@
  */
 #pragma once
 #include "aruco/dictionary.hpp"
+#include "aruco/dictionary_index.hpp"
 #include "aruco/utils.hpp"
 #include "aruco/location_mark_creator.hpp"
 #include "aruco/marker_map.hpp"
\ No newline at end of file
@@ -4,6 +4,8 @@
  *  @brief   ArUco marker dictionary
  */
 #pragma once
+#include <algorithm>
+#include <stdexcept>
 #include <vector>
 #include "utils.hpp"
 #include <Nucleona/range.hpp>
@@ -84,21 +86,29 @@ class Dictionary : public std::vector<std::uint64_t> {
 
     /**
      * @brief   Compute the max number of correction bits based on user specified ID list.
-     *          Suppose there are m markers. The time complexity would be O(m^2).
+     *          Suppose there are m markers. The time complexity would be O(m^2), 
+     *          the distances of each marker to the previous ones are counted in a batch.
      * 
      * @param   ids   A list of marker IDs defined in the dictionary
      * @return  max   Hamming distance of specified id list
      */
     auto compute_maxcor_bits(const std::vector<std::int32_t>& ids) const {
+        std::vector<std::uint64_t> codes(ids.size());
+        for (std::size_t i = 0; i != ids.size(); ++i)
+            codes[i] = this->at(ids[i]);
+        {
+            auto sorted = ids;
+            std::sort(sorted.begin(), sorted.end());
+            if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+                throw std::invalid_argument("duplicated indices detected\n");
+        }
         std::int32_t min_distance = coding_bits_ * coding_bits_;
-        for (auto j = 1; j < ids.size(); ++j) {
-            for (auto i = 0; i != j; ++i) {
-                if (ids[i] == ids[j])
-                    throw std::invalid_argument("duplicated indices detected\n");
-                auto distance = Utils::bit_count(this->at(ids[i]) ^ this->at(ids[j]));
-                if (min_distance > distance)
-                    min_distance = distance;
-            }
+        std::vector<std::int32_t> dists(ids.size());
+        for (std::size_t j = 1; j < ids.size() && min_distance > 0; ++j) {
+            Utils::bit_count(codes[j], codes.data(), j, dists.data());
+            min_distance = std::min(
+                min_distance, *std::min_element(dists.begin(), dists.begin() + j)
+            );
         }
         return min_distance / 2;
     }
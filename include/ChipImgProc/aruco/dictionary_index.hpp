@@ -0,0 +1,141 @@
+/**
+ *  @file    ChipImgProc/aruco/dictionary_index.hpp
+ *  @brief   @copybrief chipimgproc::aruco::DictionaryIndex
+ */
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "dictionary.hpp"
+
+namespace chipimgproc::aruco {
+/**
+ *  @brief  A multi-index hashing search index over the codes of a candidate marker ID list.
+ *  @details The coding bits are split into m = maxcor_bits disjoint chunks, and each
+ *           chunk keeps a sorted table of (chunk value, candidate position). A code
+ *           accepted by Dictionary::identify has a Hamming distance below maxcor_bits,
+ *           so it equals the query in at least one chunk (pigeonhole). identify() only
+ *           counts the distances of the codes found by the m chunk lookups, instead of
+ *           every candidate.
+ *
+ *           The result is the same as Dictionary::identify with the same candidate
+ *           list, including the ties (the first candidate in the list wins) and the
+ *           returned distance when nothing matches. A call with a larger maxcor_bits
+ *           than the index was built for scans all codes with the batch popcount.
+ *
+ *           The index is immutable after construction and can be shared by threads.
+ */
+class DictionaryIndex {
+  public:
+    /**
+     *  @brief  Build the index.
+     *  @param  dict         The dictionary.
+     *  @param  candidates   A list of candidate marker IDs.
+     *  @param  maxcor_bits  The max number of correction bits, -1 to use the dictionary one.
+     */
+    DictionaryIndex(
+        const Dictionary&           dict,
+        std::vector<std::int32_t>   candidates,
+        const std::int32_t          maxcor_bits = -1
+    )
+    : candidates_   (std::move(candidates))
+    , maxcor_bits_  ((maxcor_bits != -1) ? maxcor_bits : dict.maxcor_bits())
+    {
+        codes_.resize(candidates_.size());
+        for (std::size_t i = 0; i != candidates_.size(); ++i)
+            codes_[i] = dict.at(candidates_[i]);
+
+        const std::int32_t nbits = std::clamp(
+            dict.coding_bits() * dict.coding_bits(), 1, 64
+        );
+        const std::int32_t m = std::clamp(maxcor_bits_, 0, nbits);
+        chunks_.resize(m);
+        for (std::int32_t c = 0; c < m; ++c) {
+            auto& chunk  = chunks_[c];
+            auto  beg    = nbits * c / m;
+            auto  end    = nbits * (c + 1) / m;
+            chunk.shift  = beg;
+            chunk.mask   = (end - beg == 64) ? ~0ull : ((1ull << (end - beg)) - 1);
+            chunk.table.reserve(codes_.size());
+            for (std::size_t i = 0; i != codes_.size(); ++i)
+                chunk.table.emplace_back(chunk.key(codes_[i]), i);
+            std::sort(chunk.table.begin(), chunk.table.end());
+        }
+    }
+    /**
+     *  @brief  Identify the query code from the candidate list, same as Dictionary::identify.
+     *  @param  query        The query code.
+     *  @param  maxcor_bits  The max number of correction bits, -1 to use the index one.
+     *  @return The closest candidate marker ID (-1 if the search fails) and its distance.
+     */
+    std::tuple<std::int32_t, std::int32_t> identify(
+        const std::uint64_t     query,
+        const std::int32_t      maxcor_bits = -1
+    ) const {
+        std::int32_t distance = (maxcor_bits != -1) ? maxcor_bits : maxcor_bits_;
+        std::size_t  pos      = codes_.size();
+        if (distance > static_cast<std::int32_t>(chunks_.size())) {
+            // the pigeonhole bound does not hold, scan all codes
+            std::int32_t dists[64];
+            for (std::size_t i = 0; i < codes_.size() && distance > 0; i += 64) {
+                auto n = std::min<std::size_t>(64, codes_.size() - i);
+                Utils::bit_count(query, codes_.data() + i, n, dists);
+                for (std::size_t k = 0; k < n; ++k) {
+                    if (distance > dists[k]) {
+                        distance = dists[k];
+                        pos = i + k;
+                    }
+                }
+            }
+        } else {
+            for (auto&& chunk : chunks_) {
+                auto key = chunk.key(query);
+                auto itr = std::lower_bound(
+                    chunk.table.begin(), chunk.table.end(),
+                    std::make_pair(key, std::size_t(0))
+                );
+                for (; itr != chunk.table.end() && itr->first == key; ++itr) {
+                    auto d = Utils::bit_count(query ^ codes_[itr->second]);
+                    if (distance > d || (
+                        distance == d && pos != codes_.size() && pos > itr->second
+                    )) {
+                        distance = d;
+                        pos = itr->second;
+                    }
+                }
+            }
+        }
+        if (pos == codes_.size())
+            return std::make_tuple(-1, distance);
+        return std::make_tuple(candidates_[pos], distance);
+    }
+    /**
+     *  @brief  The candidate marker IDs.
+     */
+    const std::vector<std::int32_t>& candidates() const {
+        return candidates_;
+    }
+    /**
+     *  @brief  The max number of correction bits the index is built for.
+     */
+    std::int32_t maxcor_bits() const {
+        return maxcor_bits_;
+    }
+
+  private:
+    struct Chunk {
+        std::uint64_t key(std::uint64_t code) const {
+            return (code >> shift) & mask;
+        }
+        std::int32_t                                        shift;
+        std::uint64_t                                       mask ;
+        std::vector<std::pair<std::uint64_t, std::size_t>>  table;
+    };
+    std::vector<std::int32_t>   candidates_ ;
+    std::vector<std::uint64_t>  codes_      ;
+    std::int32_t                maxcor_bits_;
+    std::vector<Chunk>          chunks_     ;
+};
+} // namespace
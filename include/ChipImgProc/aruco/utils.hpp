@@ -6,6 +6,8 @@
 #pragma once
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <cstddef>
 #include <cstdint>
 #include <nlohmann/json.hpp>
 namespace chipimgproc::aruco {
@@ -24,6 +26,34 @@ struct Utils {
         x  = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0f;
         return (x * 0x0101010101010101) >> 56;
     }
+    /**
+     *  @brief Compute the Hamming distances between a query and a batch of codes,
+     *         dists[i] = bit_count(query ^ codes[i]). 
+     *  @details The codes are counted with the SIMD popcount when available.
+     *  @param query    The query code.
+     *  @param codes    The codes, n elements.
+     *  @param n        The number of codes.
+     *  @param dists    The output distances, n elements.
+     */
+    static void bit_count(
+        std::uint64_t           query, 
+        const std::uint64_t*    codes, 
+        std::size_t             n, 
+        std::int32_t*           dists
+    ) {
+        std::size_t i = 0;
+#if CV_SIMD
+        const auto vq = cv::vx_setall_u64(query);
+        std::uint64_t buf[cv::v_uint64::nlanes];
+        for (; i + cv::v_uint64::nlanes <= n; i += cv::v_uint64::nlanes) {
+            cv::v_store(buf, cv::v_popcount(cv::vx_load(codes + i) ^ vq));
+            for (int k = 0; k < cv::v_uint64::nlanes; ++k)
+                dists[i + k] = static_cast<std::int32_t>(buf[k]);
+        }
+#endif
+        for (; i < n; ++i)
+            dists[i] = bit_count(query ^ codes[i]);
+    }
     
     /**
      *  @brief Encode ArUco marker into integer.
@@ -3,6 +3,7 @@
 #include <ChipImgProc/utils.h>
 #include <ChipImgProc/utils/mat_to_vec.hpp>
 #include <ChipImgProc/utils/percentile.hpp>
+#include <ChipImgProc/algo/u16_histogram.hpp>
 #include <cmath>
 #include <ChipImgProc/algo/fitpack.h>
 #include <Nucleona/range.hpp>
@@ -28,9 +29,18 @@ constexpr struct BSpline {
         }
 
         // percentile
-        auto vec = chipimgproc::utils::mat_to_vec<T>(mat);
-        auto l = chipimgproc::utils::percentile(vec, q[0]);
-        auto u = chipimgproc::utils::percentile(vec, q[1]);
+        double l, u;
+        if(mat.depth() == CV_16U) {
+            // one counting pass for both percentiles, no copy of the image
+            chipimgproc::algo::U16Histogram hist;
+            hist.add(mat);
+            l = hist.percentile(q[0]);
+            u = hist.percentile(q[1]);
+        } else {
+            auto vec = chipimgproc::utils::mat_to_vec<T>(mat);
+            l = chipimgproc::utils::percentile(vec, q[0]);
+            u = chipimgproc::utils::percentile(vec, q[1]);
+        }
 
         // where
         std::vector<double> x;
@@ -14,7 +14,7 @@
 #include <ChipImgProc/tiled_mat.hpp>
 #include <ChipImgProc/marker/layout.hpp>
 #include <ChipImgProc/roi/reg_mat_marker_layout.hpp>
-#include <ChipImgProc/rotation/cache.hpp>
+#include <ChipImgProc/rotation/result_cache.hpp>
 #include <ChipImgProc/gridding/reg_mat.hpp>
 #include <ChipImgProc/bgb/chunk_local_mean.hpp>
 #include <Nucleona/tuple.hpp>
@@ -42,6 +42,9 @@ namespace chipimgproc{ namespace comb{
  *  7. Background process. See: chipimgproc::bgb::ChunkLocalMean <BR>
  *  9. Each grid cell margin again, because the background process may change the best margin position.
  * 
+ *  With set_lazy_rotation(), the rotation is kept as a transform of the input image 
+ *  instead of being applied to image copies, see set_lazy_rotation().
+ * 
  *  Basic usage can see unit test: <BR> 
  *  @snippet ChipImgProc/comb/single_general_test.cpp usage
  */
@@ -208,6 +211,55 @@ struct SingleGeneral {
     void set_mk_regs_hint(const std::vector<marker::detection::MKRegion>& mk_rs) {
         mk_regs_hint_ = mk_rs;
     }
+    /**
+     *  @brief Enable the lazy rotation mode.
+     *  @details By default each rotation calibration clones the input image and 
+     *           rotates the whole copy in-place, and the gridding and margin steps 
+     *           run on the last rotated copy.
+     *           In the lazy mode the rotation angle is only kept as a transform of 
+     *           the input image (see chipimgproc::rotation::Calibrate::region):
+     *           - The marker detection view is the input image itself while the 
+     *             angle is 0, otherwise it is rendered straight from the input image 
+     *             into one reused buffer, without the clone.
+     *           - The gridding only uses the marker positions, and the image of the 
+     *             margin and background steps is the grid region cut out of the last 
+     *             detection view (or the input image when the angle is 0), padded 
+     *             with 0 outside of the image. The full size view is released then, 
+     *             so no extra resample is done after the rotation estimation.
+     *           The grid lines and tiles of the returned TiledMat are relative to 
+     *           the grid region.
+     *  @param flag Enable or disable, disabled by default.
+     */
+    void set_lazy_rotation(bool flag) {
+        lazy_rotation_ = flag;
+    }
+    /**
+     *  @brief Set the persistent registration result cache, nullptr to disable.
+     *  @details The cache key is the input image content and param, which must 
+     *           describe every setting that changes the marker detection and 
+     *           rotation result (e.g. the chip type, marker layout and um2px_r).
+     *           On a hit, the rotation angle, the marker regions and the um to 
+     *           pixel rate are taken from the cache, and the marker detection and 
+     *           rotation estimation are skipped. See chipimgproc::rotation::ResultCache.
+     *  @param cache The cache, can be shared by the pipelines of a process.
+     *  @param param The parameter description of the cache key.
+     */
+    void set_result_cache(
+        std::shared_ptr<rotation::ResultCache> cache, 
+        const std::string& param = ""
+    ) {
+        result_cache_       = std::move(cache);
+        result_cache_param_ = param;
+    }
+    /**
+     *  @brief Match the markers by FFT cross correlation in the marker detection 
+     *         and the ROI bounding, see chipimgproc::algo::FFTMatchTemplate.
+     *  @param flag Enable the FFT matching, default is false.
+     */
+    void set_fft_match(bool flag) {
+        marker_detection_.set_fft_match(flag);
+        roi_bounder_.set_fft_match(flag);
+    }
 
     /**
      *  @brief The main function of image process pipeline.
@@ -228,109 +280,45 @@ struct SingleGeneral {
         std::vector<marker::detection::MKRegion> marker_regs;
         float theta                 = 0;
         float theta_off             = 0;
-        cv::Mat tmp                 = src.clone();
+        cv::Mat tmp                 = lazy_rotation_ ? src : src.clone();
+        cv::Mat rot_buf;
+        float   rot_buf_theta           = 0;
+        auto rotate = [&, this](float angle) {
+            if(!lazy_rotation_) {
+                tmp = src.clone();
+                rot_calibrator_(tmp, angle, v_rot_cali_res_);
+                return;
+            }
+            if(angle == 0) {
+                tmp = src;
+            } else {
+                rot_calibrator_.region(src, rot_buf, angle, cv::Rect(0, 0, src.cols, src.rows));
+                rot_buf_theta = angle;
+                tmp = rot_buf;
+            }
+            if(v_rot_cali_res_) {
+                v_rot_cali_res_(tmp);
+            }
+        };
         int iteration_times         = 0;
         int iteration_max_times     = 6;
         int start_record_theta_time = 2;
         float theta_threshold       = 0.01;
         std::vector<float>       candidate_theta;
         std::vector<cv::Point>   low_score_marker_idx;
-        // if has ref rotation degree, test all marker
-        if(ref_rot_degree_) {
-            // set best marker index
-            std::vector<float>          test_thetas     ;
-            std::vector<std::size_t>    test_thetas_i   ;
-            for(
-                std::size_t i = 0; 
-                i < marker_layout_.get_single_pat_candi_num();
-                i ++
-            ) {
-                auto marker_regs = marker_detection_(
-                    static_cast<const cv::Mat_<std::uint16_t>&>(tmp), 
-                    marker_layout_, 
-                    chipimgproc::MatUnit::PX, 
-                    i,
-                    *msg_
-                );
-                marker::detection::filter_low_score_marker(marker_regs);
-                auto test_theta = rot_estimator_(marker_regs, *msg_);
-                test_thetas.push_back(test_theta);
-                test_thetas_i.push_back(i);
-            }
-            std::sort(test_thetas_i.begin(), test_thetas_i.end(), [&test_thetas, this](
-                auto&& a_i, auto&& b_i
-            ){
-                return std::abs(test_thetas[a_i] - ref_rot_degree_.value()) < 
-                    std::abs(test_thetas[b_i] - ref_rot_degree_.value());
-            });
-            marker_layout_.set_single_pat_best_mk(test_thetas_i[0]);
-            theta = ref_rot_degree_.value();
-            rot_calibrator_(tmp, theta, v_rot_cali_res_);
-        } else {
-            // iterative rotation calibration
-            do{
-                auto marker_regs = marker_detection_(
-                    static_cast<const cv::Mat_<std::uint16_t>&>(tmp), 
-                    marker_layout_, 
-                    chipimgproc::MatUnit::PX, 
-                    0,
-                    *msg_
-                );
-                low_score_marker_idx = 
-                    marker::detection::filter_low_score_marker(marker_regs);
-                theta_off = rot_estimator_(marker_regs, *msg_);
-                theta += theta_off;
-                tmp = src.clone();
-                rot_calibrator_(
-                    tmp,
-                    theta,
-                    v_rot_cali_res_
-                );
-                if( iteration_times > start_record_theta_time ) {
-                    candidate_theta.push_back(theta);
-                }
-                iteration_times ++;
-                if( iteration_times >= iteration_max_times) break;
-            } while(std::abs(theta_off) > theta_threshold);
-            if( std::abs(theta_off) > theta_threshold ) {
-                *msg_ << "theta not convergence" << std::endl;
-                float sum = 0;
-                for(auto&& t : candidate_theta) {
-                    sum += t;
-                }
-                theta = sum / candidate_theta.size();
-                tmp = src.clone();
-                rot_calibrator_(
-                    tmp,
-                    theta,
-                    v_rot_cali_res_
-                );
-            }
-        }
-        // detect marker
-        if(um2px_r_detection_) {
-            if( cell_w_um_ < 0 ) throw std::runtime_error("um2px_r detection require cell micron info but not set");
-            algo::Um2PxAutoScale auto_scaler(
-                tmp, 
-                cell_w_um_,
-                cell_h_um_,
-                space_um_
-            );
-            auto[best_um2px_r, score_mat] = auto_scaler.linear_steps(
-                marker_layout_, curr_um2px_r_, 0.002, 7, 
-                low_score_marker_idx, *msg_
-            );
-            curr_um2px_r_  = best_um2px_r;
-            marker_regs    = marker::detection::reg_mat_no_rot.infer_marker_regions(
-                score_mat, marker_layout_, MatUnit::PX, *msg_
-            );
-            um2px_r_detection_ = false; 
-            // assume all chip images run in single process (which means object not destroied)
-            // is use same reader scanned, so the um2px_r not re-detected by default.
-            // um2px_r can be re-detected by manual invoke enable function.
-        }
-        else {
-            // assume the marker is single pattern regular matrix layout
+        auto cache_key = result_cache_
+            ? std::optional<rotation::ResultCache::Key>(
+                rotation::ResultCache::make_key(src, result_cache_param_))
+            : std::nullopt;
+        auto cached = cache_key
+            ? result_cache_->find(*cache_key)
+            : std::nullopt;
+        if(cached) {
+            *msg_ << "registration result cache hit" << std::endl;
+            theta           = cached->theta;
+            curr_um2px_r_   = cached->um2px_r;
+            marker_regs     = cached->markers;
+            um2px_r_detection_ = false;
             marker::make_single_pattern_reg_mat_layout(
                 marker_layout_,
                 cell_w_um_,
@@ -338,60 +326,168 @@ struct SingleGeneral {
                 space_um_,
                 curr_um2px_r_
             );
-            // try to justify the best marker regions
-            auto tp_marker_regs = marker::detection::reg_mat_no_rot(
-                tmp, marker_layout_, MatUnit::PX, 
-                low_score_marker_idx, *msg_, v_marker_seg_
-            );
-            if(mk_regs_hint_.empty()) {
-                *msg_ << "marker regions no hint, direct use template match result\n";
-                // no choice just accept tp_marker_regs
-                marker_regs = std::move(tp_marker_regs);
+            rotate(theta);
+        } else {
+            // if has ref rotation degree, test all marker
+            if(ref_rot_degree_) {
+                // set best marker index
+                std::vector<float>          test_thetas     ;
+                std::vector<std::size_t>    test_thetas_i   ;
+                for(
+                    std::size_t i = 0; 
+                    i < marker_layout_.get_single_pat_candi_num();
+                    i ++
+                ) {
+                    auto marker_regs = marker_detection_(
+                        static_cast<const cv::Mat_<std::uint16_t>&>(tmp), 
+                        marker_layout_, 
+                        chipimgproc::MatUnit::PX, 
+                        i,
+                        *msg_
+                    );
+                    marker::detection::filter_low_score_marker(marker_regs);
+                    auto test_theta = rot_estimator_(marker_regs, *msg_);
+                    test_thetas.push_back(test_theta);
+                    test_thetas_i.push_back(i);
+                }
+                std::sort(test_thetas_i.begin(), test_thetas_i.end(), [&test_thetas, this](
+                    auto&& a_i, auto&& b_i
+                ){
+                    return std::abs(test_thetas[a_i] - ref_rot_degree_.value()) < 
+                        std::abs(test_thetas[b_i] - ref_rot_degree_.value());
+                });
+                marker_layout_.set_single_pat_best_mk(test_thetas_i[0]);
+                theta = ref_rot_degree_.value();
+                if(lazy_rotation_) {
+                    rotate(theta);
+                } else {
+                    rot_calibrator_(tmp, theta, v_rot_cali_res_);
+                }
             } else {
-                auto& mk_des = marker_layout_.get_single_pat_marker_des();
-                auto& std_mk_px = mk_des.get_std_mk(MatUnit::PX);
-                for(auto&& mk : mk_regs_hint_) {
-                    mk.width = std_mk_px.cols;
-                    mk.height = std_mk_px.rows;
-                    mk.x = std::round((float)mk.x - mk.width  / 2.0);
-                    mk.y = std::round((float)mk.y - mk.height / 2.0);
+                // iterative rotation calibration
+                do{
+                    auto marker_regs = marker_detection_(
+                        static_cast<const cv::Mat_<std::uint16_t>&>(tmp), 
+                        marker_layout_, 
+                        chipimgproc::MatUnit::PX, 
+                        0,
+                        *msg_
+                    );
+                    low_score_marker_idx = 
+                        marker::detection::filter_low_score_marker(marker_regs);
+                    theta_off = rot_estimator_(marker_regs, *msg_);
+                    theta += theta_off;
+                    rotate(theta);
+                    if( iteration_times > start_record_theta_time ) {
+                        candidate_theta.push_back(theta);
+                    }
+                    iteration_times ++;
+                    if( iteration_times >= iteration_max_times) break;
+                } while(std::abs(theta_off) > theta_threshold);
+                if( std::abs(theta_off) > theta_threshold ) {
+                    *msg_ << "theta not convergence" << std::endl;
+                    float sum = 0;
+                    for(auto&& t : candidate_theta) {
+                        sum += t;
+                    }
+                    theta = sum / candidate_theta.size();
+                    rotate(theta);
                 }
-                auto hint_marker_regs = marker::detection::reg_mat_infer(
-                    mk_regs_hint_,
-                    marker_layout_.mk_map.rows,
-                    marker_layout_.mk_map.cols,
-                    static_cast<cv::Mat_<std::uint16_t>&>(tmp), 
-                    *msg_,
-                    v_marker_seg_
+            }
+            // detect marker
+            if(um2px_r_detection_) {
+                if( cell_w_um_ < 0 ) throw std::runtime_error("um2px_r detection require cell micron info but not set");
+                algo::Um2PxAutoScale auto_scaler(
+                    tmp, 
+                    cell_w_um_,
+                    cell_h_um_,
+                    space_um_
+                );
+                auto[best_um2px_r, score_mat] = auto_scaler.linear_steps(
+                    marker_layout_, curr_um2px_r_, 0.002, 7, 
+                    low_score_marker_idx, *msg_
+                );
+                curr_um2px_r_  = best_um2px_r;
+                marker_regs    = marker::detection::reg_mat_no_rot.infer_marker_regions(
+                    score_mat, marker_layout_, MatUnit::PX, *msg_
+                );
+                um2px_r_detection_ = false; 
+                // assume all chip images run in single process (which means object not destroied)
+                // is use same reader scanned, so the um2px_r not re-detected by default.
+                // um2px_r can be re-detected by manual invoke enable function.
+            }
+            else {
+                // assume the marker is single pattern regular matrix layout
+                marker::make_single_pattern_reg_mat_layout(
+                    marker_layout_,
+                    cell_w_um_,
+                    cell_h_um_,
+                    space_um_,
+                    curr_um2px_r_
                 );
-                *msg_ << VDUMP(hint_marker_regs.size()) << '\n';
-                // test is tp_marker_regs usable.
-                auto tp_theta = rot_estimator_(tp_marker_regs);
-                if(std::abs(tp_theta) > 1) {
-                    *msg_ << "marker regions hint detected and template match markers quality too bad, use hint\n";
-                    // the tp_marker_res is unacceptable, use hint data
-                    marker_regs = std::move(hint_marker_regs);
+                // try to justify the best marker regions
+                auto tp_marker_regs = marker::detection::reg_mat_no_rot(
+                    tmp, marker_layout_, MatUnit::PX, 
+                    low_score_marker_idx, *msg_, v_marker_seg_
+                );
+                if(mk_regs_hint_.empty()) {
+                    *msg_ << "marker regions no hint, direct use template match result\n";
+                    // no choice just accept tp_marker_regs
+                    marker_regs = std::move(tp_marker_regs);
                 } else {
-                    auto& std_mk_cl = mk_des.get_std_mk(MatUnit::CELL);
-                    const auto px_per_cl_w = std_mk_px.cols / (float)std_mk_cl.cols;
-                    const auto shift_thd_w = px_per_cl_w / 2;
+                    auto& mk_des = marker_layout_.get_single_pat_marker_des();
+                    auto& std_mk_px = mk_des.get_std_mk(MatUnit::PX);
+                    for(auto&& mk : mk_regs_hint_) {
+                        mk.width = std_mk_px.cols;
+                        mk.height = std_mk_px.rows;
+                        mk.x = std::round((float)mk.x - mk.width  / 2.0);
+                        mk.y = std::round((float)mk.y - mk.height / 2.0);
+                    }
+                    auto hint_marker_regs = marker::detection::reg_mat_infer(
+                        mk_regs_hint_,
+                        marker_layout_.mk_map.rows,
+                        marker_layout_.mk_map.cols,
+                        static_cast<cv::Mat_<std::uint16_t>&>(tmp), 
+                        *msg_,
+                        v_marker_seg_
+                    );
+                    *msg_ << VDUMP(hint_marker_regs.size()) << '\n';
+                    // test is tp_marker_regs usable.
+                    auto tp_theta = rot_estimator_(tp_marker_regs);
+                    if(std::abs(tp_theta) > 1) {
+                        *msg_ << "marker regions hint detected and template match markers quality too bad, use hint\n";
+                        // the tp_marker_res is unacceptable, use hint data
+                        marker_regs = std::move(hint_marker_regs);
+                    } else {
+                        auto& std_mk_cl = mk_des.get_std_mk(MatUnit::CELL);
+                        const auto px_per_cl_w = std_mk_px.cols / (float)std_mk_cl.cols;
+                        const auto shift_thd_w = px_per_cl_w / 2;
 
-                    const auto px_per_cl_h = std_mk_px.rows / (float)std_mk_cl.rows;
-                    const auto shift_thd_h = px_per_cl_h / 2;
+                        const auto px_per_cl_h = std_mk_px.rows / (float)std_mk_cl.rows;
+                        const auto shift_thd_h = px_per_cl_h / 2;
 
-                    if( std::abs(tp_marker_regs.at(0).x - hint_marker_regs.at(0).x) < shift_thd_w && 
-                        std::abs(tp_marker_regs.at(0).y - hint_marker_regs.at(0).y) < shift_thd_h
-                    ) {
-                        *msg_ << "both marker region hint and template match are good, use template match\n";
-                        // close enough, the template match should better use tp_marker_regs
-                        marker_regs = std::move(tp_marker_regs);
-                    } else {
-                        *msg_ << "marker regions hint detected and template match markers too far from hint, use hint\n";
-                        // too far, the template match is probably failed, use hint_marker_regs
-                        marker_regs = std::move(hint_marker_regs);
+                        if( std::abs(tp_marker_regs.at(0).x - hint_marker_regs.at(0).x) < shift_thd_w && 
+                            std::abs(tp_marker_regs.at(0).y - hint_marker_regs.at(0).y) < shift_thd_h
+                        ) {
+                            *msg_ << "both marker region hint and template match are good, use template match\n";
+                            // close enough, the template match should better use tp_marker_regs
+                            marker_regs = std::move(tp_marker_regs);
+                        } else {
+                            *msg_ << "marker regions hint detected and template match markers too far from hint, use hint\n";
+                            // too far, the template match is probably failed, use hint_marker_regs
+                            marker_regs = std::move(hint_marker_regs);
+                        }
                     }
                 }
             }
+            if(cache_key) {
+                rotation::ResultCache::Entry entry;
+                entry.theta     = theta;
+                entry.um2px_r   = curr_um2px_r_;
+                entry.warp_mat  = rotation::Calibrate::rotation_matrix(src.size(), theta);
+                entry.markers   = marker_regs;
+                result_cache_->save(*cache_key, entry);
+            }
         }
         auto grid_res   = gridder_(tmp, marker_layout_, marker_regs, *msg_, v_grid_res_);
         if(v_marker_append_) {
@@ -400,6 +496,37 @@ struct SingleGeneral {
             );
             v_marker_append_(marker_append_res);
         }
+        if(lazy_rotation_) {
+            // cut the grid region out of the detection view, which is already 
+            // rendered at the final angle, and pad the part outside of the image 
+            // with 0 like the warp does. Only the unrotated view is taken from 
+            // the input image. The region is a copy, the margin and background 
+            // steps modify it in-place.
+            auto roi = grid_region(grid_res);
+            cv::Mat view = (theta != 0 && !rot_buf.empty() && rot_buf_theta == theta)
+                ? rot_buf : src;
+            if(view.data == src.data && theta != 0) {
+                tmp = cv::Mat();
+                rot_calibrator_.region(src, tmp, theta, roi);
+            } else {
+                auto inner = roi & cv::Rect(0, 0, view.cols, view.rows);
+                cv::Mat region;
+                cv::copyMakeBorder(
+                    view(inner), region,
+                    inner.y - roi.y, roi.br().y - inner.br().y,
+                    inner.x - roi.x, roi.br().x - inner.br().x,
+                    cv::BORDER_CONSTANT, cv::Scalar(0)
+                );
+                tmp = region;
+            }
+            rot_buf = cv::Mat();
+            for(auto& t : grid_res.tiles) {
+                t.x -= roi.x;
+                t.y -= roi.y;
+            }
+            for(auto& x : grid_res.gl_x) x -= roi.x;
+            for(auto& y : grid_res.gl_y) y -= roi.y;
+        }
         auto tiled_mat  = TiledMat<>::make_from_grid_res(
             grid_res, tmp, marker_layout_
         );
@@ -484,6 +611,21 @@ struct SingleGeneral {
         );
     }
   private:
+    /**
+     *  @brief The bounding box of the grid tiles and grid lines.
+     */
+    static cv::Rect grid_region(const gridding::Result& grid_res) {
+        auto [x0, x1] = std::minmax_element(grid_res.gl_x.begin(), grid_res.gl_x.end());
+        auto [y0, y1] = std::minmax_element(grid_res.gl_y.begin(), grid_res.gl_y.end());
+        cv::Rect roi(
+            cv::Point(std::floor(*x0), std::floor(*y0)),
+            cv::Point(std::ceil(*x1) + 1, std::ceil(*y1) + 1)
+        );
+        for(auto&& t : grid_res.tiles) {
+            roi |= t;
+        }
+        return roi;
+    }
     std::string                         margin_method_     { "mid_seg" }                   ; // available algorithm: mid_seg, auto_min_cv
     float                               seg_rate_          { 0.6 }                         ;
     marker::Layout                      marker_layout_                                     ;
@@ -495,6 +637,11 @@ struct SingleGeneral {
     float                               cell_w_um_         {-1}                            ;
     float                               space_um_          {-1}                            ;
     std::optional<float>                ref_rot_degree_    { 0}                            ;
+    bool                                lazy_rotation_     {false}                         ;
+    std::shared_ptr<
+        rotation::ResultCache
+    >                                   result_cache_      {nullptr}                       ;
+    std::string                         result_cache_param_                                ;
     std::vector<
         marker::detection::MKRegion
     >                                   mk_regs_hint_                                      ;
@@ -523,7 +670,6 @@ struct SingleGeneral {
     chipimgproc::marker::detection::RegMat       marker_detection_   ;
     chipimgproc::rotation::MarkerVec<FLOAT>      rot_estimator_      ;
     chipimgproc::rotation::Calibrate             rot_calibrator_     ;
-    chipimgproc::rotation::Cache<FLOAT>          rot_cache_          ;
     chipimgproc::gridding::RegMat                gridder_            ;
     chipimgproc::Margin<FLOAT, GLID>             margin_             ;
     chipimgproc::roi::RegMatMarkerLayout         roi_bounder_        ;
@@ -22,6 +22,16 @@ struct Gridding
         std::vector<std::uint32_t> gl_x, gl_y;
     };
     // using FLOAT = float;
+    /**
+     *  @brief  Fit the grid line positions of one direction by a sine wave.
+     *  @details The dominant frequency is found by the DFT of the 1D projection
+     *           zero padded to 2^lg2nfft, and the phase by a least squares fit of
+     *           [cos, sin, 1] to the projection.
+     *           With set_streaming_fit(true), the least squares fit accumulates 
+     *           the 3x3 normal equations in one pass instead of building the
+     *           N x 3 design matrix, and the DFT reuses the padded input and the 
+     *           packed (CCS) spectrum buffers of the previous call.
+     */
     template <int32_t dim, int32_t lg2nfft>
     auto fit_sinewave(
           const cv::Mat_<FLOAT>& src
@@ -34,6 +44,8 @@ struct Gridding
         cv::reduce(src, data, dim, cv::REDUCE_AVG, data.depth());
         if (dim == 1)
             cv::transpose(data, data);
+        if (streaming_fit_)
+            return fit_sinewave_streaming<lg2nfft>(data, max_invl, out);
     
         // Moving average
         cv::Mat_<FLOAT> ac;
@@ -94,6 +106,14 @@ struct Gridding
     
         return anchors;
     }
+    /**
+     *  @brief  Use the streaming sine wave fit, see fit_sinewave(). 
+     *          By default the design matrix solve is used.
+     */
+    void set_streaming_fit(bool flag)
+    {
+        streaming_fit_ = flag;
+    }
         
     /**
      *  @brief  Recognize the grid border of the image.
@@ -172,6 +192,88 @@ struct Gridding
         };
         return res;
     }
+private:
+    template <int32_t lg2nfft>
+    auto fit_sinewave_streaming(
+          cv::Mat_<FLOAT>& data
+        , const double max_invl
+        , std::ostream& out
+    )
+    {
+        const int nfft  = 1 << lg2nfft;
+        const int n     = data.total();
+        data -= cv::mean(data);
+
+        // Zero padded input, only the samples of the previous call are cleared
+        if (dft_in_.cols != nfft)
+        {
+            dft_in_ = cv::Mat_<FLOAT>::zeros(1, nfft);
+            dft_used_ = 0;
+        }
+        if (dft_used_ > n)
+            dft_in_.colRange(n, dft_used_) = 0;
+        data.reshape(1, 1).copyTo(dft_in_.colRange(0, n));
+        dft_used_ = n;
+
+        // Frequency detection on the packed spectrum, bin i is (ft(2i-1), ft(2i))
+        cv::dft(dft_in_, dft_out_);
+        const auto& ft = dft_out_;
+        FLOAT max = 0.0;
+        FLOAT loc = 0.0;
+        auto last = ft.total() >> 1;
+        for (auto i = decltype(last)(ft.total()/max_invl); i != last; ++i)
+        {
+            double val = (i == 0) 
+                ? std::abs(ft(0)) 
+                : std::sqrt( (double)ft(2 * i - 1) * ft(2 * i - 1) 
+                           + (double)ft(2 * i)     * ft(2 * i) );
+            if (max < val)
+            {
+                max = val;
+                loc = i;
+            }
+        }
+        double freq = loc / static_cast<FLOAT>(ft.total());
+        out << "invl = " << 1.0 / freq << '\n';
+
+        // Phase estimation, normal equations of [cos, sin, 1] accumulated in one pass
+        const auto v = 2.0 * CV_PI * freq;
+        double scc = 0, scs = 0, sc = 0, sss = 0, ss = 0;
+        double bc = 0, bs = 0, b1 = 0;
+        for (int i = 0; i != n; ++i)
+        {
+            const double c = std::cos(v * i);
+            const double s = std::sin(v * i);
+            const double d = data(i);
+            scc += c * c;   scs += c * s;   sc += c;
+            sss += s * s;   ss  += s;
+            bc  += c * d;   bs  += s * d;   b1 += d;
+        }
+        cv::Matx33d A(
+            scc, scs, sc,
+            scs, sss, ss,
+            sc,  ss,  n
+        );
+        cv::Vec3d w = A.solve(cv::Vec3d(bc, bs, b1), cv::DECOMP_SVD);
+        const double phase = std::atan2(w(0), w(1)) * 0.5 / CV_PI + 0.25;
+        out << "phase = " << phase << '\n';
+
+        // Generate gridlines
+        std::vector<FLOAT> anchors;
+        int32_t start = std::ceil(phase);
+        int32_t end = std::floor(freq * n + phase);
+        while (std::round((start - 1 - phase) / freq) > 0) --start;
+        while (std::round((end - phase) / freq) < n) ++end;
+        for (auto i = start; i != end; ++i)
+            anchors.emplace_back((i - phase) / freq);
+
+        return anchors;
+    }
+
+    bool            streaming_fit_  { false };
+    cv::Mat_<FLOAT> dft_in_         ;
+    cv::Mat_<FLOAT> dft_out_        ;
+    int             dft_used_       { 0 };
 };
 }
 #include "gridding/pseudo.hpp"
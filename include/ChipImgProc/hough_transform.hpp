@@ -5,9 +5,23 @@
 // #include <CCD/utility/tune_scope.hpp>
 #include <Nucleona/parallel/thread_pool.hpp>
 #include <Nucleona/range.hpp>
+#include <ChipImgProc/algo/block_parallel.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <atomic>
+#include <tuple>
+#include <type_traits>
 #include <iostream>
 namespace chipimgproc
 {
+/**
+ * @brief The voting engine of HoughTransform.
+ */
+enum class HoughEngine {
+    atomic,         ///< HoughTransform::operator(), atomic uint16 accumulator
+    private_acc,    ///< HoughTransform::vote, exact private accumulators
+    simd            ///< HoughTransform::vote_simd, edge list and SIMD rho kernel
+};
 template<class FLOAT>
 struct HoughTransform
 {
@@ -47,28 +61,41 @@ struct HoughTransform
         return unitvecs_;
     }
 
+    /**
+     * @brief Set the number of worker threads of operator() and the number of 
+     *        private accumulators of vote(), by default 4.
+     */
+    void set_thread_num(int thread_num)
+    {
+        thread_num_ = std::max(thread_num, 1);
+    }
+    int thread_num() const
+    {
+        return thread_num_;
+    }
+    /**
+     * @brief Run vote() on a shared executor instead of creating its own threads,
+     *        nullptr to use chipimgproc::algo::block_parallel with thread_num threads.
+     */
+    void set_executor(algo::BlockExecutor executor)
+    {
+        executor_ = std::move(executor);
+    }
+
     auto operator()( cv::Mat img )
     {
         const auto cols = img.cols;
         const auto rows = img.rows;
-        const auto tmid = std::atan2(rows, cols) * 180.0 / CV_PI;
-        const auto rmin = std::floor(
-            (tmax_ > 90.0)? rho(cols, 0, tmax_): 0.0
-        );
-        // const auto rmin = -50;
-        const FLOAT rmax = std::ceil(
-            (tmax_ < tmid)? rho(cols, rows, tmax_)
-          : (tmin_ < tmid)? std::sqrt(rows * rows + cols * cols)
-          : (tmin_ < 90.0)? rho(cols, rows, tmin_)
-          :                rho(0   , rows, tmin_)
-        );
+        double rmin;
+        FLOAT  rmax;
+        std::tie(rmin, rmax) = rho_range(cols, rows);
 
         cv::Mat_<std::atomic<std::uint16_t>> hist = cv::Mat_<std::atomic<std::uint16_t>>::zeros(unitvecs_.size(), rmax - rmin + 1);
         // chipimgproc::info(std::cout, hist);
-        const auto thread_num = 4;
+        const auto thread_num = thread_num_;
         {
             auto thread_pool = nucleona::parallel::make_thread_pool( thread_num );
-            auto segsize = img.rows / thread_num;
+            auto segsize = std::max(img.rows / thread_num, 1);
             for ( int seg_beg = 0; seg_beg < img.rows; seg_beg += segsize) {
                 segsize = std::min(segsize, img.rows - seg_beg);
                 int seg_end = seg_beg + segsize;            
@@ -95,9 +122,229 @@ struct HoughTransform
         return hist;
     
     }
+    /**
+     * @brief Exact voting with private accumulators, same bins as operator().
+     * @details The image rows are split into thread_num chunks and each chunk 
+     *          votes into its own uint32 accumulator without any synchronization, 
+     *          then a parallel reduction over the theta rows sums the accumulators 
+     *          in chunk order. Unlike operator() no vote is lost and the counts 
+     *          do not overflow, so the result is exact and independent of the 
+     *          scheduling. The x term of rho is precomputed per theta and column, 
+     *          with the same float arithmetic as UnitVector::rho.
+     *          Each chunk holds a full theta x rho accumulator, so the memory 
+     *          grows with thread_num.
+     * 
+     * @param img   The CV_8U edge image, pixels > 127 vote.
+     * @return cv::Mat_<std::int32_t> The vote histogram, theta x rho.
+     */
+    cv::Mat_<std::int32_t> vote( const cv::Mat& img ) const
+    {
+        const auto cols = img.cols;
+        const auto rows = img.rows;
+        double rmin;
+        FLOAT  rmax;
+        std::tie(rmin, rmax) = rho_range(cols, rows);
+        const int tn = unitvecs_.size();
+        const int rn = rmax - rmin + 1;
+
+        std::vector<int> theta_bins(tn);
+        std::vector<FLOAT> x_terms(static_cast<std::size_t>(tn) * cols);
+        for ( int t = 0; t < tn; t ++ )
+        {
+            auto& u = unitvecs_[t];
+            theta_bins[t] = std::round((u.theta - tmin_) / tstep_);
+            for ( int c = 0; c < cols; c ++ )
+                x_terms[t * cols + c] = c * u.cos_theta;
+        }
+
+        auto executor = executor_ ? executor_ : algo::make_block_executor(thread_num_);
+        const int chunk_num = std::max(std::min(thread_num_, rows), 1);
+        std::vector<std::vector<std::uint32_t>> accs(chunk_num);
+        executor(chunk_num, [&](int blk, int beg, int end) {
+            for ( int k = beg; k < end; k ++ )
+            {
+                auto& acc = accs[k];
+                acc.assign(static_cast<std::size_t>(tn) * rn, 0);
+                const int r_beg = static_cast<long>(rows) * k / chunk_num;
+                const int r_end = static_cast<long>(rows) * (k + 1) / chunk_num;
+                for ( int r = r_beg; r < r_end; r ++ )
+                {
+                    auto* row = img.template ptr<std::uint8_t>(r);
+                    for ( int c = 0; c < cols; c ++ )
+                    {
+                        if ( row[c] <= 127 ) continue;
+                        for ( int t = 0; t < tn; t ++ )
+                        {
+                            FLOAT rho = x_terms[t * cols + c] + r * unitvecs_[t].sin_theta;
+                            int hj = std::round(rho - rmin);
+                            if ( hj < 0 || hj >= rn ) continue;
+                            acc[static_cast<std::size_t>(theta_bins[t]) * rn + hj] ++;
+                        }
+                    }
+                }
+            }
+        });
+
+        return reduce_votes(accs, tn, rn, executor);
+    }
+    /**
+     * @brief Same bins and counts as vote(), with a compacted edge list and a 
+     *        SIMD rho kernel.
+     * @details Each row chunk first gathers the coordinates of its edge pixels, 
+     *          so the threshold test is done once per pixel instead of once per 
+     *          pixel and theta. Then for each theta the rho of the edge pixels is 
+     *          computed v_float32::nlanes pixels at a time with the OpenCV universal 
+     *          intrinsics (SSE/AVX2/NEON, the width the library is compiled for), 
+     *          and only the accumulator increments are scalar.
+     *          The rho is computed with the same float multiply and add as vote(), 
+     *          and rounded in double as round(rho - rmin) = floor(rho - (rmin - 0.5)), 
+     *          so the bins are exactly those of vote(). The kernel is used when FLOAT 
+     *          is float and the build has CV_SIMD and CV_SIMD_64F, otherwise the 
+     *          edge list is voted by the scalar loop.
+     *
+     * @param img   The CV_8U edge image, pixels > 127 vote.
+     * @return cv::Mat_<std::int32_t> The vote histogram, theta x rho.
+     */
+    cv::Mat_<std::int32_t> vote_simd( const cv::Mat& img ) const
+    {
+        const auto cols = img.cols;
+        const auto rows = img.rows;
+        double rmin;
+        FLOAT  rmax;
+        std::tie(rmin, rmax) = rho_range(cols, rows);
+        const int tn = unitvecs_.size();
+        const int rn = rmax - rmin + 1;
+
+        auto executor = executor_ ? executor_ : algo::make_block_executor(thread_num_);
+        const int chunk_num = std::max(std::min(thread_num_, rows), 1);
+        std::vector<std::vector<std::uint32_t>> accs(chunk_num);
+        executor(chunk_num, [&](int blk, int beg, int end) {
+            std::vector<FLOAT> xs, ys;
+            for ( int k = beg; k < end; k ++ )
+            {
+                auto& acc = accs[k];
+                acc.assign(static_cast<std::size_t>(tn) * rn, 0);
+                const int r_beg = static_cast<long>(rows) * k / chunk_num;
+                const int r_end = static_cast<long>(rows) * (k + 1) / chunk_num;
+                xs.clear();
+                ys.clear();
+                for ( int r = r_beg; r < r_end; r ++ )
+                {
+                    auto* row = img.template ptr<std::uint8_t>(r);
+                    for ( int c = 0; c < cols; c ++ )
+                    {
+                        if ( row[c] <= 127 ) continue;
+                        xs.push_back(c);
+                        ys.push_back(r);
+                    }
+                }
+                for ( int t = 0; t < tn; t ++ )
+                {
+                    auto& u = unitvecs_[t];
+                    int hi = std::round((u.theta - tmin_) / tstep_);
+                    vote_edges(xs, ys, u, rmin, rn, acc.data() + static_cast<std::size_t>(hi) * rn);
+                }
+            }
+        });
+        return reduce_votes(accs, tn, rn, executor);
+    }
 private:
+    /**
+     * @brief Vote the edge list of one theta into an accumulator row.
+     */
+    static void vote_edges(
+        const std::vector<FLOAT>&   xs
+      , const std::vector<FLOAT>&   ys
+      , const UnitVector&           u
+      , double                      rmin
+      , int                         rn
+      , std::uint32_t*              acc_row
+    )
+    {
+        const int n = xs.size();
+        int i = 0;
+#if CV_SIMD && CV_SIMD_64F
+        if constexpr ( std::is_same_v<FLOAT, float> )
+        {
+            constexpr int lanes = cv::v_float32::nlanes;
+            const auto vcos = cv::vx_setall_f32(u.cos_theta);
+            const auto vsin = cv::vx_setall_f32(u.sin_theta);
+            const auto voff = cv::vx_setall_f64(rmin - 0.5);
+            float   rhos[lanes];
+            int     hjs [lanes];
+            for ( ; i + lanes <= n; i += lanes )
+            {
+                auto rho = cv::vx_load(xs.data() + i) * vcos
+                         + cv::vx_load(ys.data() + i) * vsin;
+                auto hj  = cv::v_combine_low(
+                    cv::v_floor(cv::v_cvt_f64(rho)      - voff),
+                    cv::v_floor(cv::v_cvt_f64_high(rho) - voff)
+                );
+                cv::v_store(rhos, rho);
+                cv::v_store(hjs , hj );
+                for ( int l = 0; l < lanes; l ++ )
+                {
+                    if ( hjs[l] < 0 || hjs[l] >= rn ) continue;
+                    // floor(x + 0.5) and round(x) only differ at x == -0.5
+                    if ( hjs[l] == 0 && std::round(rhos[l] - rmin) != 0 ) continue;
+                    acc_row[hjs[l]] ++;
+                }
+            }
+        }
+#endif
+        for ( ; i < n; i ++ )
+        {
+            FLOAT rho = xs[i] * u.cos_theta + ys[i] * u.sin_theta;
+            int hj = std::round(rho - rmin);
+            if ( hj < 0 || hj >= rn ) continue;
+            acc_row[hj] ++;
+        }
+    }
+    /**
+     * @brief Sum the private accumulators in chunk order, parallel over the theta rows.
+     */
+    static cv::Mat_<std::int32_t> reduce_votes(
+        const std::vector<std::vector<std::uint32_t>>&  accs
+      , int                                             tn
+      , int                                             rn
+      , const algo::BlockExecutor&                      executor
+    )
+    {
+        cv::Mat_<std::int32_t> hist = cv::Mat_<std::int32_t>::zeros(tn, rn);
+        executor(tn, [&](int blk, int beg, int end) {
+            for ( int t = beg; t < end; t ++ )
+            {
+                auto* dst = hist.template ptr<std::int32_t>(t);
+                for ( auto& acc : accs )
+                {
+                    if ( acc.empty() ) continue;
+                    auto* src = acc.data() + static_cast<std::size_t>(t) * rn;
+                    for ( int j = 0; j < rn; j ++ )
+                        dst[j] += src[j];
+                }
+            }
+        });
+        return hist;
+    }
+    std::tuple<double, FLOAT> rho_range( int cols, int rows ) const
+    {
+        const auto tmid = std::atan2(rows, cols) * 180.0 / CV_PI;
+        const auto rmin = std::floor(
+            (tmax_ > 90.0)? rho(cols, 0, tmax_): 0.0
+        );
+        // const auto rmin = -50;
+        const FLOAT rmax = std::ceil(
+            (tmax_ < tmid)? rho(cols, rows, tmax_)
+          : (tmin_ < tmid)? std::sqrt(rows * rows + cols * cols)
+          : (tmin_ < 90.0)? rho(cols, rows, tmin_)
+          :                rho(0   , rows, tmin_)
+        );
+        return std::make_tuple(rmin, rmax);
+    }
     std::vector<UnitVector> unitvecs_;
     FLOAT tmin_, tmax_, tstep_;
+    int                     thread_num_ {4};
+    algo::BlockExecutor     executor_   ;
 };
 
 void hough_transform_dummy();
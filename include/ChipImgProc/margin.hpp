@@ -50,6 +50,11 @@ struct Margin {
      *             The window size is specified by the parameter @a param.seg_rate, 
      *             which refers to the relative size of the shrinkage area.
      *              
+     *           * auto_min_cv_integral
+     *
+     *             Same result as auto_min_cv, the candidate windows are scored by 
+     *             integral images, see chipimgproc::margin::AutoMinCV::find_min_cv_integral.
+     *
      *           * mid_seg
      *
      *             This method takes the center region of the feature area to summarize the probe signal.
@@ -89,8 +94,10 @@ struct Margin {
         const margin::Param<GLID>&  param
     ) const {
         margin::Result<FLOAT> res;
-        if(method == "auto_min_cv") {
+        if(method == "auto_min_cv" || method == "auto_min_cv_integral") {
             margin::AutoMinCV<FLOAT> auto_min_cv;
+            set_dispatch(auto_min_cv, param);
+            auto_min_cv.set_integral_search(method == "auto_min_cv_integral");
             auto tmp = auto_min_cv(
                 *param.tiled_mat, 
                 param.seg_rate,
@@ -101,6 +108,7 @@ struct Margin {
             res.stat_mats = tmp;
         } else if(method == "mid_seg") {
             margin::MidSeg<FLOAT> mid_seg;
+            set_dispatch(mid_seg, param);
             auto tmp = mid_seg(
                 *param.tiled_mat, 
                 param.seg_rate,
@@ -110,6 +118,7 @@ struct Margin {
             res.stat_mats = tmp;
         } else if(method == "percentile") {
             margin::Percentile<FLOAT> func;
+            set_dispatch(func, param);
             auto tmp = func(
                 *param.tiled_mat, 
                 param.seg_rate,
@@ -134,6 +143,7 @@ struct Margin {
             res.stat_mats = tmp;
         } else if (method == "sig_est") {
             margin::SigEst<FLOAT> func;
+            set_dispatch(func, param);
             auto tmp = func(
                 *param.tiled_mat,
                 param.seg_rate,
@@ -146,7 +156,14 @@ struct Margin {
         }
         return res;
     }
-
+private:
+    static void set_dispatch(
+        margin::TileDispatch&       engine, 
+        const margin::Param<GLID>&  param
+    ) {
+        engine.set_thread_num(param.thread_num);
+        engine.set_executor(param.executor);
+    }
 };
 
 }
@@ -12,7 +12,10 @@
 #include <ChipImgProc/tiled_mat.hpp>
 #include <ChipImgProc/stat/cell.hpp>
 #include <ChipImgProc/stat/mats.hpp>
+#include <ChipImgProc/margin/tile_dispatch.hpp>
 #include <algorithm>
+#include <cmath>
+#include <limits>
 
 namespace chipimgproc { namespace margin{
 /**
@@ -24,7 +27,15 @@ namespace chipimgproc { namespace margin{
  */
 template<class FLOAT>
 struct AutoMinCV
+: public TileDispatch
 {
+    /**
+     * @brief   The selected window and its statistics.
+     */
+    struct MinCV {
+        stat::Cell<FLOAT> stat;
+        cv::Rect win;
+    };
     stat::Cell<FLOAT> count_cv ( const cv::Mat& mat ) const 
     {
         return stat::Cell<FLOAT>::make(mat);
@@ -64,13 +75,122 @@ struct AutoMinCV
         if( min_cv_win.width <= 0 )  { throw std::runtime_error("min cv tile constrain check fail"); };
         if( min_cv_win.height <= 0 ) { throw std::runtime_error("min cv tile constrain check fail"); };
         // min.detail_raw_value = src(t);
-        struct {
-            stat::Cell<FLOAT> stat;
-            cv::Rect win;
-        } res {
-            min, min_cv_win
-        };
-        return res;
+        return MinCV { min, min_cv_win };
+    }
+    /**
+     * @brief   Same as find_min_cv, but each candidate window is scored in O(1) 
+     *          by the sum and squared sum integral images of the tile.
+     * @details The integrals are built per tile over the pixel values minus the 
+     *          tile minimum, so their magnitudes only depend on the tile size and 
+     *          contrast, not on the image size or brightness (16-bit integer 
+     *          tiles are summed exactly). Each window gets an interval of its CV 
+     *          from a rounding error bound of the integral terms, and a window is 
+     *          pruned only when its lower bound is above the smallest upper bound. 
+     *          The remaining windows are re-evaluated by count_cv in the original 
+     *          scan order, so the selected window and its statistics are 
+     *          identical to find_min_cv.
+     */
+    auto find_min_cv_integral(
+          const cv::Mat& src
+        , const cv::Rect& t
+        , std::int32_t windows_width
+        , std::int32_t windows_height 
+    ) const {
+        // margin for the float rounding of the CV by count_cv
+        constexpr double rel_tol = 1e-5;
+        constexpr double abs_tol = 1e-9;
+        const std::int32_t nx = t.width  - windows_width  + 1;
+        const std::int32_t ny = t.height - windows_height + 1;
+        if((t & cv::Rect(0, 0, src.cols, src.rows)) != t || src.channels() != 1 
+            || nx <= 0 || ny <= 0 || windows_width <= 0 || windows_height <= 0
+        ) {
+            return find_min_cv(src, t, windows_width, windows_height);
+        }
+        cv::Mat_<double> tile;
+        src(t).convertTo(tile, CV_64F);
+        double offset;
+        cv::minMaxLoc(tile, &offset);
+        tile -= offset;
+        cv::Mat_<double> sum, sqsum;
+        cv::integral(tile, sum, sqsum, CV_64F, CV_64F);
+
+        constexpr double eps = std::numeric_limits<double>::epsilon();
+        // accumulated rounding of an integral entry, relative to its magnitude
+        const double gamma = (t.width + t.height + 8) * eps;
+        const double n = static_cast<double>(windows_width) * windows_height;
+        std::vector<double> lower(nx * ny);
+        double min_upper = std::numeric_limits<double>::infinity();
+        for ( std::int32_t i = 0; i < ny; i ++ )
+        {
+            auto* s0 = sum  .template ptr<double>(i);
+            auto* s1 = sum  .template ptr<double>(i + windows_height);
+            auto* q0 = sqsum.template ptr<double>(i);
+            auto* q1 = sqsum.template ptr<double>(i + windows_height);
+            for ( std::int32_t j = 0; j < nx; j ++ )
+            {
+                auto x1 = j + windows_width;
+                double s = s1[x1] - s1[j] - s0[x1] + s0[j];
+                double q = q1[x1] - q1[j] - q0[x1] + q0[j];
+                double s_err = gamma * (
+                    std::abs(s1[x1]) + std::abs(s1[j]) + std::abs(s0[x1]) + std::abs(s0[j])
+                );
+                double q_err = gamma * (
+                    std::abs(q1[x1]) + std::abs(q1[j]) + std::abs(q0[x1]) + std::abs(q0[j])
+                );
+                // n^2 * variance and n * mean, with their error bounds
+                double var = n * q - s * s;
+                double var_err = n * q_err + (2 * std::abs(s) + s_err) * s_err
+                    + 4 * eps * (n * std::abs(q) + s * s);
+                double mean = n * offset + s;
+                double mean_err = s_err + 4 * eps * (std::abs(n * offset) + std::abs(s));
+                if(!(mean - mean_err > 0) || !std::isfinite(var + var_err)) {
+                    // the sign of the mean is uncertain, never pruned
+                    lower[i * nx + j] = -std::numeric_limits<double>::infinity();
+                    continue;
+                }
+                lower[i * nx + j] = std::sqrt(std::max(var - var_err, 0.0)) / (mean + mean_err);
+                double upper = std::sqrt(var + var_err) / (mean - mean_err);
+                if(upper < min_upper) min_upper = upper;
+            }
+        }
+        const double bound = min_upper + min_upper * rel_tol + abs_tol;
+        stat::Cell<FLOAT> min;
+        cv::Rect min_cv_win(0, 0, windows_width, windows_height);
+        min.cv = std::numeric_limits<float>::max();
+        for ( std::int32_t i = 0; i < ny; i ++ )
+        {
+            for ( std::int32_t j = 0; j < nx; j ++ )
+            {
+                if(lower[i * nx + j] > bound) continue;
+                cv::Rect_<int32_t> rect(
+                    t.x + j, t.y + i, 
+                    windows_width, windows_height
+                );
+                auto win_res_ele = count_cv( src( rect ) );
+                if ( win_res_ele.cv < min.cv )
+                {
+                    min = win_res_ele;
+                    min_cv_win.x = rect.x;
+                    min_cv_win.y = rect.y;
+                }
+            }
+        }
+        min.num = windows_height * windows_width;
+        if( min_cv_win.x < 0 )       { throw std::runtime_error("min cv tile constrain check fail"); };
+        if( min_cv_win.y < 0 )       { throw std::runtime_error("min cv tile constrain check fail"); };
+        if( min_cv_win.width <= 0 )  { throw std::runtime_error("min cv tile constrain check fail"); };
+        if( min_cv_win.height <= 0 ) { throw std::runtime_error("min cv tile constrain check fail"); };
+        return MinCV { min, min_cv_win };
+    }
+    /**
+     * @brief   Enable/disable the integral image window search, see find_min_cv_integral.
+     *          By default it is disabled.
+     */
+    void set_integral_search(bool enable) {
+        integral_search_ = enable;
+    }
+    bool integral_search() const {
+        return integral_search_;
     }
     /**
      * @brief   @copybrief ChipImgProc/min_cv_auto_margin.hpp
@@ -92,29 +212,36 @@ struct AutoMinCV
     {
         stat::Mats<FLOAT> res(rows(tiled_src), cols(tiled_src));
         auto& tiles = tiled_src.get_tiles();
-        for( int y = 0; y < rows(tiled_src); y ++ ) {
-            for ( int x = 0; x < cols(tiled_src); x ++ ) {
-                auto t = tiled_src.tile_at(y, x);
-                auto x_basic_margin = basic_margin_rate * t.width;
-                auto y_basic_margin = basic_margin_rate * t.height;
-                t.x += x_basic_margin;
-                t.y += y_basic_margin;
-                t.width -= (2 * x_basic_margin);
-                t.height -= (2 * y_basic_margin);
-                int windows_width  = std::round(t.width  * seg_rate);
-                int windows_height = std::round(t.height * seg_rate);
-                auto min_cv_data = find_min_cv(
-                    tiled_src.get_cali_img(), t, 
-                    windows_width, windows_height
-                );
-                res.mean   (y, x) = min_cv_data.stat.mean;
-                res.stddev (y, x) = min_cv_data.stat.stddev;
-                res.cv     (y, x) = min_cv_data.stat.cv;
-                res.num    (y, x) = min_cv_data.stat.num;
-                if( tile_replace )
-                    tiled_src.tile_at(y, x) = min_cv_data.win;
+        dispatch_rows(rows(tiled_src), [&](int blk, int y_beg, int y_end) {
+            for( int y = y_beg; y < y_end; y ++ ) {
+                for ( int x = 0; x < cols(tiled_src); x ++ ) {
+                    auto t = tiled_src.tile_at(y, x);
+                    auto x_basic_margin = basic_margin_rate * t.width;
+                    auto y_basic_margin = basic_margin_rate * t.height;
+                    t.x += x_basic_margin;
+                    t.y += y_basic_margin;
+                    t.width -= (2 * x_basic_margin);
+                    t.height -= (2 * y_basic_margin);
+                    int windows_width  = std::round(t.width  * seg_rate);
+                    int windows_height = std::round(t.height * seg_rate);
+                    auto min_cv_data = integral_search_
+                        ? find_min_cv_integral(
+                            tiled_src.get_cali_img(), t,
+                            windows_width, windows_height
+                        )
+                        : find_min_cv(
+                            tiled_src.get_cali_img(), t, 
+                            windows_width, windows_height
+                        );
+                    res.mean   (y, x) = min_cv_data.stat.mean;
+                    res.stddev (y, x) = min_cv_data.stat.stddev;
+                    res.cv     (y, x) = min_cv_data.stat.cv;
+                    res.num    (y, x) = min_cv_data.stat.num;
+                    if( tile_replace )
+                        tiled_src.tile_at(y, x) = min_cv_data.win;
+                }
             }
-        }
+        });
         auto& mat = tiled_src.get_cali_img();
         if(mat.depth() == CV_32F || mat.depth() == CV_64F){
             auto tmp = mat.clone();
@@ -127,6 +254,8 @@ struct AutoMinCV
         }
         return res;
     };
+private:
+    bool integral_search_ {false};
 };
 
 }
@@ -3,11 +3,13 @@
 #include <ChipImgProc/tiled_mat.hpp>
 #include <ChipImgProc/stat/cell.hpp>
 #include <ChipImgProc/stat/mats.hpp>
+#include <ChipImgProc/margin/tile_dispatch.hpp>
 
 namespace chipimgproc { namespace margin{
 
 template<class FLOAT>
 struct MidSeg
+: public TileDispatch
 {
     template<class GLID>
     auto operator()( 
@@ -26,32 +28,34 @@ struct MidSeg
         auto ts_cols = cols(tiled_src);
         stat::Mats<FLOAT> res(ts_rows, ts_cols);
         auto& tiles = tiled_src.get_tiles();
-        for( int y = 0; y < ts_rows; y ++ ) {
-            for( int x = 0; x < ts_cols; x ++ ) {
-                cv::Rect tile( tiled_src.tile_at(y, x) );
-                int width  = std::round(tile.width  * mid_rate);
-                int height = std::round(tile.height * mid_rate);
-                auto x_off = ( tile.width  - width  ) / 2;
-                auto y_off = ( tile.height - height ) / 2;
+        dispatch_rows(ts_rows, [&](int blk, int y_beg, int y_end) {
+            for( int y = y_beg; y < y_end; y ++ ) {
+                for( int x = 0; x < ts_cols; x ++ ) {
+                    cv::Rect tile( tiled_src.tile_at(y, x) );
+                    int width  = std::round(tile.width  * mid_rate);
+                    int height = std::round(tile.height * mid_rate);
+                    auto x_off = ( tile.width  - width  ) / 2;
+                    auto y_off = ( tile.height - height ) / 2;
 
-                tile.x += x_off;
-                tile.y += y_off;
-                tile.width = width;
-                tile.height = height;
+                    tile.x += x_off;
+                    tile.y += y_off;
+                    tile.width = width;
+                    tile.height = height;
 
-                auto cell = stat::Cell<FLOAT>::make(
-                    tiled_src.get_cali_img()(tile)
-                );
+                    auto cell = stat::Cell<FLOAT>::make(
+                        tiled_src.get_cali_img()(tile)
+                    );
 
-                res.mean   (y, x) = cell.mean;
-                res.stddev (y, x) = cell.stddev;
-                res.cv     (y, x) = cell.cv;
-                res.num    (y, x) = cell.num;
-                if( tile_replace )
-                    tiled_src.tile_at(y, x) = tile;
+                    res.mean   (y, x) = cell.mean;
+                    res.stddev (y, x) = cell.stddev;
+                    res.cv     (y, x) = cell.cv;
+                    res.num    (y, x) = cell.num;
+                    if( tile_replace )
+                        tiled_src.tile_at(y, x) = tile;
 
+                }
             }
-        }
+        });
 
         // draw gridding result
         if(v_result)
@@ -7,6 +7,7 @@
 #pragma once
 #include <cstdint>
 #include <ChipImgProc/tiled_mat.hpp>
+#include <ChipImgProc/margin/tile_dispatch.hpp>
 namespace chipimgproc{ namespace margin{
 /**
  * @brief    This Param class is a pack of input parameters
@@ -61,6 +62,19 @@ struct Param {
     std::function<
         void(const cv::Mat&)
     >                       v_result       ;
+
+    /**
+     * @brief    the number of worker threads of the tile-parallel methods 
+     *           (auto_min_cv, mid_seg, percentile and sig_est), by default 1.
+     *           See chipimgproc::margin::TileDispatch.
+     */
+    int                     thread_num     {1};
+
+    /**
+     * @brief    a custom executor of the tile-parallel methods, 
+     *           overrides @a thread_num if set.
+     */
+    TileExecutor            executor       {};
 };
 
 
@@ -9,10 +9,14 @@
 #include <ChipImgProc/stat/mats.hpp>
 #include <algorithm>
 #include <ChipImgProc/margin/mid_seg.hpp>
+#include <ChipImgProc/algo/u16_histogram.hpp>
+#include <memory>
 namespace chipimgproc::margin{
 
 template<class FLOAT>
-struct Percentile {
+struct Percentile 
+: public TileDispatch
+{
 
     auto tile_percentile(
           const cv::Mat& src
@@ -41,6 +45,37 @@ struct Percentile {
         res.mean = sum / res.num;
         return res;
     }
+    /**
+     * @brief Same as tile_percentile, the trimmed mean of a CV_16U tile is 
+     *        computed exactly by a histogram instead of sorting the tile.
+     * 
+     * @param hist  The histogram buffer, reused across tiles.
+     */
+    auto tile_percentile(
+          const cv::Mat& src
+        , const cv::Rect& t
+        , FLOAT percentage
+        , algo::U16Histogram& hist
+    ) const {
+        auto trim_rate = (1.0 - percentage) / 2;
+        hist.clear();
+        hist.add(src(t));
+        auto size = hist.size();
+        std::size_t begin_pos = std::round(trim_rate * size);
+        std::size_t capture_size = std::round(percentage * size);
+        if(begin_pos + capture_size > size) {
+            throw std::out_of_range("tile percentile capture range out of tile");
+        }
+
+        stat::Cell<FLOAT> res;
+        res.cv = std::numeric_limits<FLOAT>::max();
+        res.stddev = std::numeric_limits<FLOAT>::max();
+        res.num = capture_size;
+
+        FLOAT sum = hist.prefix_sum(begin_pos + capture_size) - hist.prefix_sum(begin_pos);
+        res.mean = sum / res.num;
+        return res;
+    }
     template<class GLID>
     auto operator()( 
           TiledMat<GLID>&           tiled_src
@@ -51,23 +86,33 @@ struct Percentile {
           >&                        v_result            = nullptr
     ) const {
         MidSeg<FLOAT> mid_seg;
+        static_cast<TileDispatch&>(mid_seg) = *this;
         mid_seg(tiled_src, 0.8, true);
         stat::Mats<FLOAT> res(rows(tiled_src), cols(tiled_src));
         auto& tiles = tiled_src.get_tiles();
-        for( int y = 0; y < rows(tiled_src); y ++ ) {
-            for ( int x = 0; x < cols(tiled_src); x ++ ) {
-                auto t = tiled_src.tile_at(y, x);
-                auto pt_data = tile_percentile(
-                    tiled_src.get_cali_img(), t, percentage
-                );
-                res.mean   (y, x) = pt_data.mean;
-                res.stddev (y, x) = pt_data.stddev;
-                res.cv     (y, x) = pt_data.cv;
-                res.num    (y, x) = pt_data.num;
-                if( tile_replace )
-                    tiled_src.tile_at(y, x) = t;
+        const bool use_hist = tiled_src.get_cali_img().type() == CV_16UC1;
+        dispatch_rows(rows(tiled_src), [&](int blk, int y_beg, int y_end) {
+            std::unique_ptr<algo::U16Histogram> hist;
+            if(use_hist) hist = std::make_unique<algo::U16Histogram>();
+            for( int y = y_beg; y < y_end; y ++ ) {
+                for ( int x = 0; x < cols(tiled_src); x ++ ) {
+                    auto t = tiled_src.tile_at(y, x);
+                    auto pt_data = use_hist
+                        ? tile_percentile(
+                            tiled_src.get_cali_img(), t, percentage, *hist
+                        )
+                        : tile_percentile(
+                            tiled_src.get_cali_img(), t, percentage
+                        );
+                    res.mean   (y, x) = pt_data.mean;
+                    res.stddev (y, x) = pt_data.stddev;
+                    res.cv     (y, x) = pt_data.cv;
+                    res.num    (y, x) = pt_data.num;
+                    if( tile_replace )
+                        tiled_src.tile_at(y, x) = t;
+                }
             }
-        }
+        });
         auto& mat = tiled_src.get_cali_img();
         if(mat.depth() == CV_32F || mat.depth() == CV_64F){
             auto tmp = mat.clone();
@@ -6,8 +6,6 @@
 #pragma once
 #include <cstdint>
 #include <vector>
-#include <map>
-#include <tuple>
 #include <cmath>
 #include <ChipImgProc/utils.h>
 #include <cassert>
@@ -16,12 +14,15 @@
 #include <ChipImgProc/stat/cell.hpp>
 #include <ChipImgProc/stat/mats.hpp>
 #include <ChipImgProc/algo/partial_percentile.hpp>
+#include <ChipImgProc/margin/tile_dispatch.hpp>
+#include <ChipImgProc/margin/sig_est_geometry.hpp>
 #include <algorithm>
 
 namespace chipimgproc { namespace margin{
 
 template<class FLOAT>
 struct SigEst
+: public TileDispatch
 {
     // stat::Cell<FLOAT> count_cv ( const cv::Mat& mat ) const 
     // {
@@ -91,88 +92,57 @@ struct SigEst
     {
         stat::Mats<FLOAT> res(rows(tiled_src), cols(tiled_src));
         auto& tiles = tiled_src.get_tiles();
-        double frank = 0.90, foffset = 0.40 * 0.5;
-        double brank = 0.05, boffset = 0.25 * 0.5;
-        
-        std::map<
-            std::tuple<int32_t,int32_t>
-          , std::tuple<
-                int32_t
-              , int32_t
-              , cv::Rect
-              , std::vector<cv::Point>
-              , std::vector<cv::Point>
-            >
-        > cache;
+        double frank = 0.90;
+        double brank = 0.05;
 
-        chipimgproc::PartialPercentile<uint16_t> partial_percentile;
+        /* The tile geometry comes from the table shared across FOVs and calls, 
+           which is read only during the parallel tile evaluation. */
+        geometry_->prepare(tiled_src.get_tiles());
+        auto geometry = geometry_->snapshot();
+        
         auto&& matx = tiled_src.get_cali_img();
-        for (auto r = 0; r != rows(tiled_src); ++r) {
-            for (auto c = 0; c != cols(tiled_src); ++c) {
-                auto tile = tiled_src.tile_at(r, c);
+        dispatch_rows(rows(tiled_src), [&](int blk, int r_beg, int r_end) {
+            /* The partial percentile scratch is private to a block. The uint16 
+               partial percentile counts the shared indices without reordering 
+               them, so the result of a tile does not depend on the tiles 
+               processed before it. */
+            chipimgproc::PartialPercentile<uint16_t> partial_percentile;
+            for (auto r = r_beg; r != r_end; ++r) {
+                for (auto c = 0; c != cols(tiled_src); ++c) {
+                    auto tile = tiled_src.tile_at(r, c);
 
-                auto key = std::make_tuple(tile.width, tile.height);
-                if (cache.find(key) == cache.end()) {
-                    int32_t f_dx = std::round(foffset * tile.width );
-                    int32_t f_dy = std::round(foffset * tile.height);
-                    int32_t b_dx = std::max(1.0, std::round(boffset * tile.width ));
-                    int32_t b_dy = std::max(1.0, std::round(boffset * tile.height));
-                    cv::Mat_<uint8_t> mask(tile.height + 2 * b_dy, tile.width + 2 * b_dx);
+                    auto&& [ dx, dy, selection, fidxs, bidxs ] 
+                        = geometry->at(tile.width, tile.height);
+                    tile.x -= dx;
+                    tile.y -= dy;
+                    tile.width  += dx * 2;
+                    tile.height += dy * 2;
 
-                    auto&& [ dx, dy, selection, fidxs, bidxs ] = cache[key];
-                    dx = b_dx;
-                    dy = b_dy;
+                    cv::Mat_<uint16_t> patch = matx(tile);
+                    auto fgval = partial_percentile(patch, frank, fidxs);
+                    auto bgval = partial_percentile(patch, brank, bidxs);
+                    auto stdev = 0.0;
+                    for (auto&& point: fidxs)
+                        stdev = static_cast<double>(patch(point)) * patch(point);
+                    stdev /= fidxs.size();
+                    stdev -= fgval * fgval;
+                    stdev = std::sqrt(stdev);
 
-                    selection = cv::Rect(
-                        b_dx * 2
-                      , b_dy * 2
-                      , tile.width  - b_dx * 4
-                      , tile.height - b_dy * 4
-                    );
-                    mask = 1;
-                    mask(selection) = 0;
-                    cv::findNonZero(mask, bidxs);
+                    res.mean  (r, c) = std::max(1.0, fgval - bgval);
+                    res.stddev(r, c) = stdev;
+                    res.cv    (r, c) = stdev / fgval;
+                    res.bg    (r, c) = bgval;
+                    res.num   (r, c) = fidxs.size();
 
-                    selection = cv::Rect(
-                        b_dx + f_dx
-                      , b_dy + f_dy
-                      , tile.width  - (b_dx + f_dx) * 2
-                      , tile.height - (b_dx + f_dx) * 2
-                    );
-                    mask = 0;
-                    mask(selection) = 1;
-                    cv::findNonZero(mask, fidxs);
+                    tile.x += selection.x;
+                    tile.y += selection.y;
+                    tile.width  = selection.width;
+                    tile.height = selection.height;
+                    if( tile_replace )
+                        tiled_src.tile_at(r, c) = tile;
                 }
-                auto&& [ dx, dy, selection, fidxs, bidxs ] = cache[key];
-                tile.x -= dx;
-                tile.y -= dy;
-                tile.width  += dx * 2;
-                tile.height += dy * 2;
-
-                cv::Mat_<uint16_t> patch = matx(tile);
-                auto fgval = partial_percentile(patch, frank, fidxs);
-                auto bgval = partial_percentile(patch, brank, bidxs);
-                auto stdev = 0.0;
-                for (auto&& point: fidxs)
-                    stdev = static_cast<double>(patch(point)) * patch(point);
-                stdev /= fidxs.size();
-                stdev -= fgval * fgval;
-                stdev = std::sqrt(stdev);
-
-                res.mean  (r, c) = std::max(1.0, fgval - bgval);
-                res.stddev(r, c) = stdev;
-                res.cv    (r, c) = stdev / fgval;
-                res.bg    (r, c) = bgval;
-                res.num   (r, c) = fidxs.size();
-
-                tile.x += selection.x;
-                tile.y += selection.y;
-                tile.width  = selection.width;
-                tile.height = selection.height;
-                if( tile_replace )
-                    tiled_src.tile_at(r, c) = tile;
             }
-        }
+        });
         auto& mat = tiled_src.get_cali_img();
         if(mat.depth() == CV_32F || mat.depth() == CV_64F){
             auto tmp = mat.clone();
@@ -185,6 +155,17 @@ struct SigEst
         }
         return res;
     };
+    /**
+     * @brief Set the tile geometry table, by default SigEstGeometry::shared().
+     */
+    void set_geometry(std::shared_ptr<SigEstGeometry> geometry) {
+        geometry_ = std::move(geometry);
+    }
+    const std::shared_ptr<SigEstGeometry>& geometry() const {
+        return geometry_;
+    }
+private:
+    std::shared_ptr<SigEstGeometry> geometry_ {SigEstGeometry::shared()};
 };
 
 }
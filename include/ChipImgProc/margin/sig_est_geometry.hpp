@@ -0,0 +1,185 @@
+/**
+ * @file    sig_est_geometry.hpp
+ * @brief   @copybrief chipimgproc::margin::SigEstGeometry
+ */
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <ChipImgProc/utils.h>
+namespace chipimgproc{ namespace margin{
+
+/**
+ * @brief    The foreground/background sample geometry of SigEst, keyed by the tile size.
+ * @details  The geometry only depends on the tile width and height, so one table
+ *           is shared by all FOVs and calls (see shared()). The entries of the tile
+ *           sizes smaller than Table::flat_max are stored in a flat table indexed by
+ *           (height, width), the larger ones are keyed by (width, height) in a map,
+ *           so the table size does not grow with the square of the largest tile.
+ *
+ *           The table is copy-on-write. prepare() adds the missing tile sizes into
+ *           a new table under a lock and publishes it, and snapshot() returns the
+ *           current table, which is immutable and read without any locking by the
+ *           parallel tile evaluation.
+ */
+struct SigEstGeometry {
+    /**
+     * @brief The geometry of a tile size.
+     */
+    struct Entry {
+        std::int32_t            dx          ;   ///< horizontal tile expansion of the background ring
+        std::int32_t            dy          ;   ///< vertical tile expansion of the background ring
+        cv::Rect                selection   ;   ///< foreground region in the expanded tile
+        std::vector<cv::Point>  fidxs       ;   ///< foreground points in the expanded tile
+        std::vector<cv::Point>  bidxs       ;   ///< background points in the expanded tile
+    };
+    /**
+     * @brief An immutable table of entries.
+     */
+    struct Table {
+        /**
+         * @brief The flat table bound of the tile width and height.
+         */
+        static constexpr int flat_max = 64;
+
+        const Entry* find(int w, int h) const {
+            if(w < 0 || h < 0) return nullptr;
+            if(w < flat_max && h < flat_max) {
+                if(w >= cols || h >= rows) return nullptr;
+                return index[h * cols + w].get();
+            }
+            auto itr = large.find({w, h});
+            return itr == large.end() ? nullptr : itr->second.get();
+        }
+        const Entry& at(int w, int h) const {
+            auto* entry = find(w, h);
+            if(!entry) {
+                throw std::out_of_range(
+                    "SigEstGeometry: tile size not prepared, "
+                    + std::to_string(w) + "x" + std::to_string(h)
+                );
+            }
+            return *entry;
+        }
+        int                                         cols    {0};
+        int                                         rows    {0};
+        std::vector<std::shared_ptr<const Entry>>   index   ;
+        std::map<
+            std::pair<int, int>, 
+            std::shared_ptr<const Entry>
+        >                                           large   ;
+    };
+
+    SigEstGeometry()
+    : table_(std::make_shared<const Table>())
+    {}
+
+    /**
+     * @brief Make sure all tile sizes of the tiled matrix are in the table.
+     *        Thread safe.
+     */
+    template<class TILES>
+    void prepare(const TILES& tiles) {
+        auto curr = snapshot();
+        bool complete = true;
+        for(auto&& t : tiles) {
+            if(!curr->find(t.width, t.height)) {
+                complete = false;
+                break;
+            }
+        }
+        if(complete) return;
+
+        std::lock_guard<std::mutex> lock(mux_);
+        auto table = std::make_shared<Table>(*table_);
+        for(auto&& t : tiles) {
+            if(t.width < 0 || t.height < 0) {
+                throw std::invalid_argument("SigEstGeometry: negative tile size");
+            }
+            if(t.width >= Table::flat_max || t.height >= Table::flat_max) {
+                auto& slot = table->large[{t.width, t.height}];
+                if(!slot) slot = make_entry(t.width, t.height);
+                continue;
+            }
+            if(t.width >= table->cols || t.height >= table->rows) {
+                resize(*table,
+                    std::max(table->cols, t.width + 1),
+                    std::max(table->rows, t.height + 1)
+                );
+            }
+            auto& slot = table->index[t.height * table->cols + t.width];
+            if(!slot) slot = make_entry(t.width, t.height);
+        }
+        table_ = std::move(table);
+    }
+    /**
+     * @brief The current table, read only and never modified after published.
+     */
+    std::shared_ptr<const Table> snapshot() const {
+        std::lock_guard<std::mutex> lock(mux_);
+        return table_;
+    }
+    /**
+     * @brief The table shared by all SigEst objects of the process.
+     */
+    static const std::shared_ptr<SigEstGeometry>& shared() {
+        static std::shared_ptr<SigEstGeometry> geometry
+            = std::make_shared<SigEstGeometry>();
+        return geometry;
+    }
+private:
+    static void resize(Table& table, int cols, int rows) {
+        std::vector<std::shared_ptr<const Entry>> index(cols * rows);
+        for(int h = 0; h < table.rows; h ++) {
+            for(int w = 0; w < table.cols; w ++) {
+                index[h * cols + w] = std::move(table.index[h * table.cols + w]);
+            }
+        }
+        table.index = std::move(index);
+        table.cols  = cols;
+        table.rows  = rows;
+    }
+    static std::shared_ptr<const Entry> make_entry(int width, int height) {
+        const double foffset = 0.40 * 0.5;
+        const double boffset = 0.25 * 0.5;
+        auto entry = std::make_shared<Entry>();
+        int32_t f_dx = std::round(foffset * width );
+        int32_t f_dy = std::round(foffset * height);
+        int32_t b_dx = std::max(1.0, std::round(boffset * width ));
+        int32_t b_dy = std::max(1.0, std::round(boffset * height));
+        cv::Mat_<uint8_t> mask(height + 2 * b_dy, width + 2 * b_dx);
+        entry->dx = b_dx;
+        entry->dy = b_dy;
+
+        entry->selection = cv::Rect(
+            b_dx * 2
+          , b_dy * 2
+          , width  - b_dx * 4
+          , height - b_dy * 4
+        );
+        mask = 1;
+        mask(entry->selection) = 0;
+        cv::findNonZero(mask, entry->bidxs);
+
+        entry->selection = cv::Rect(
+            b_dx + f_dx
+          , b_dy + f_dy
+          , width  - (b_dx + f_dx) * 2
+          , height - (b_dx + f_dx) * 2
+        );
+        mask = 0;
+        mask(entry->selection) = 1;
+        cv::findNonZero(mask, entry->fidxs);
+        return entry;
+    }
+    std::shared_ptr<const Table>    table_  ;
+    mutable std::mutex              mux_    ;
+};
+
+}}
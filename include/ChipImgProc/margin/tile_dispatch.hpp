@@ -0,0 +1,67 @@
+/**
+ * @file    tile_dispatch.hpp
+ * @brief   @copybrief chipimgproc::margin::TileDispatch
+ */
+#pragma once
+#include <functional>
+#include <utility>
+#include <ChipImgProc/algo/block_parallel.hpp>
+namespace chipimgproc{ namespace margin{
+
+/**
+ * @brief    The executor of the tile-parallel margin engines.
+ * @details  An executor runs job(block_id, beg, end) over disjoint blocks which 
+ *           cover the tile rows [0, n) and returns after all blocks finished. 
+ *           Exceptions thrown by a job should be propagated to the caller.
+ */
+using TileExecutor = algo::BlockExecutor;
+
+/**
+ * @brief    The shared tile dispatch layer of the margin engines.
+ * @details  The tiles of a TiledMat are independent, the engines split the tile 
+ *           rows into blocks and each block writes only its own elements of the 
+ *           preallocated stat::Mats and its own tiles (the tile_replace write back), 
+ *           so the output does not depend on the thread number or the executor.
+ *           By default the blocks run on chipimgproc::algo::block_parallel with 
+ *           thread_num threads, and a custom executor (e.g. an application wide 
+ *           thread pool) can be set instead.
+ */
+struct TileDispatch {
+    /**
+     * @brief Set the number of worker threads of the default executor, 
+     *        by default 1 (serial).
+     */
+    void set_thread_num(int thread_num) {
+        thread_num_ = thread_num;
+    }
+    int thread_num() const {
+        return thread_num_;
+    }
+    /**
+     * @brief Set a custom executor, nullptr to use the default one.
+     */
+    void set_executor(TileExecutor executor) {
+        executor_ = std::move(executor);
+    }
+    const TileExecutor& executor() const {
+        return executor_;
+    }
+protected:
+    /**
+     * @brief Run job(block_id, row_beg, row_end) over the tile rows [0, rows).
+     */
+    template<class Job>
+    void dispatch_rows(int rows, Job&& job) const {
+        if(rows <= 0) return;
+        if(executor_) {
+            executor_(rows, std::function<void(int, int, int)>(std::ref(job)));
+        } else {
+            algo::block_parallel(rows, thread_num_, job);
+        }
+    }
+private:
+    int             thread_num_ {1};
+    TileExecutor    executor_   ;
+};
+
+}}
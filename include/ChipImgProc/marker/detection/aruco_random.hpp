@@ -1,6 +1,10 @@
 #pragma once
 #include "random_based.hpp"
 #include <ChipImgProc/aruco.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <memory>
+#include <mutex>
 
 namespace chipimgproc::marker::detection {
 
@@ -26,6 +30,7 @@ protected:
     )
     , dict_         (dict)
     , ext_width_    (0)
+    , index_cache_  (std::make_shared<IndexCache>())
     {
         assert(aruco_width >= dict_->coding_bits() * ext_width);
 
@@ -73,6 +78,113 @@ protected:
         }
         return binary;
     }
+    /**
+     * @brief The same decoding as to_binary_, without any cv::Mat allocation.
+     * @details Each anchor window is bilinearly sampled straight from the patch
+     *          into a stack array, with the 16-bit fixed point weights and the 
+     *          rounding of cv::getRectSubPix on 8-bit images, so the samples and 
+     *          the bits are the same. A window touching the patch border is 
+     *          sampled by cv::getRectSubPix itself into the array, for its border 
+     *          rule. The histogram for the Otsu threshold is counted while 
+     *          sampling. Falls back to to_binary_ when the windows do not fit in 
+     *          the array.
+     */
+    std::uint64_t to_binary_direct_(
+        const cv::Mat&                  patch, 
+        const std::vector<cv::Vec2f>&   anchors,
+        const int                       thres = 3
+    ) const {
+        constexpr int max_samples = 1 << 14;
+        constexpr int shift = 16; // fixed point bits of each weight, as cv::getRectSubPix
+        const int coding_bits = this->dict_->coding_bits();
+        const int num_anchors = coding_bits * coding_bits;
+        const int w = ext_width_;
+        const int cell = w * w;
+        if (patch.type() != CV_8UC1 || cell * num_anchors > max_samples || w <= 0)
+            return to_binary_(patch, anchors, thres);
+
+        std::uint8_t samples[max_samples];
+        std::uint32_t hist[256] = {0};
+        for (int i = 0; i != num_anchors; ++i) {
+            float cx = anchors[i][0] - (w - 1) * 0.5f;
+            float cy = anchors[i][1] - (w - 1) * 0.5f;
+            int ix = cvFloor(cx);
+            int iy = cvFloor(cy);
+            float a = cx - ix;
+            float b = cy - iy;
+            const int a11 = cvRound((1.f - a) * (1.f - b) * (1 << shift));
+            const int a12 = cvRound(a * (1.f - b) * (1 << shift));
+            const int a21 = cvRound((1.f - a) * b * (1 << shift));
+            const int a22 = cvRound(a * b * (1 << shift));
+            auto* out = samples + i * cell;
+            // the inside condition of cv::getRectSubPix
+            if (ix < 0 || ix >= patch.cols - w || iy < 0 || iy >= patch.rows - w) {
+                cv::Mat_<std::uint8_t> win(w, w, out);
+                cv::getRectSubPix(patch, win.size(), anchors[i], win);
+                for (int k = 0; k < cell; ++k)
+                    hist[out[k]] ++;
+                continue;
+            }
+            for (int y = 0; y < w; ++y) {
+                auto* r0 = patch.ptr<std::uint8_t>(iy + y) + ix;
+                auto* r1 = patch.ptr<std::uint8_t>(iy + y + 1) + ix;
+                for (int x = 0; x < w; ++x) {
+                    int v = r0[x] * a11 + r0[x + 1] * a12 + r1[x] * a21 + r1[x + 1] * a22;
+                    auto p = static_cast<std::uint8_t>((v + (1 << (shift - 1))) >> shift);
+                    out[y * w + x] = p;
+                    hist[p] ++;
+                }
+            }
+        }
+        const int t = otsu_threshold_(hist, cell * num_anchors);
+        std::uint64_t binary = 0ull;
+        for (int i = 0; i != num_anchors; ++i) {
+            auto* cell_samples = samples + i * cell;
+            int count = 0;
+            for (int k = 0; k < cell; ++k)
+                count += cell_samples[k] > t;
+            std::uint64_t bit = count > thres;
+            binary |= bit << i;
+        }
+        return binary;
+    }
+    /**
+     * @brief The Otsu threshold of a 8-bit histogram, same as cv::threshold.
+     */
+    static int otsu_threshold_(const std::uint32_t (&hist)[256], int total) {
+        const double scale = 1.0 / total;
+        double mu = 0;
+        for (int i = 0; i < 256; ++i)
+            mu += i * static_cast<double>(hist[i]);
+        mu *= scale;
+        double mu1 = 0, q1 = 0;
+        double max_sigma = 0, max_val = 0;
+        for (int i = 0; i < 256; ++i) {
+            double p_i = hist[i] * scale;
+            mu1 *= q1;
+            q1 += p_i;
+            double q2 = 1. - q1;
+            if (std::min(q1, q2) < FLT_EPSILON || std::max(q1, q2) > 1. - FLT_EPSILON)
+                continue;
+            mu1 = (mu1 + i * p_i) / q1;
+            double mu2 = (mu - q1 * mu1) / q2;
+            double sigma = q1 * q2 * (mu1 - mu2) * (mu1 - mu2);
+            if (sigma > max_sigma) {
+                max_sigma = sigma;
+                max_val = i;
+            }
+        }
+        return static_cast<int>(max_val);
+    }
+    std::uint64_t decode_(
+        const cv::Mat&                  patch, 
+        const std::vector<cv::Vec2f>&   anchors,
+        const int                       thres
+    ) const {
+        return direct_decode_ 
+            ? to_binary_direct_(patch, anchors, thres)
+            : to_binary_(patch, anchors, thres);
+    }
 
 
 public:
@@ -84,32 +196,108 @@ public:
         const int                       thres = 3
     ) const {
         // cv::imwrite("debug.png", patch);
-        const auto& w           = ext_width_;
         const auto  coding_bits = dict_->coding_bits();
         const auto  num_anchors = coding_bits * coding_bits;
-        const auto  tmp_wh      = coding_bits * w;
-        cv::Mat_<std::uint8_t> tmp(tmp_wh, tmp_wh);
 
         if(num_anchors > anchors.size()) {
             throw std::runtime_error(
                 "BUG: The anchors number not match the assumption of \"identify\" function"
             );
         }
-        auto binary = to_binary_(patch, anchors, thres);
+        auto binary = decode_(patch, anchors, thres);
         auto [id, distance] = dict_->identify(binary, active_ids);
         return {id, distance};
     }
 
+    /**
+     * @brief Same as the active ID list version, with the candidates searched 
+     *        by a prebuilt aruco::DictionaryIndex.
+     */
+    RndMkId identify(
+        const cv::Mat&                  patch,
+        const std::vector<cv::Vec2f>&   anchors,
+        const aruco::DictionaryIndex&   index,
+        const int                       thres = 3
+    ) const {
+        const auto  coding_bits = dict_->coding_bits();
+        const auto  num_anchors = coding_bits * coding_bits;
+        if(num_anchors > anchors.size()) {
+            throw std::runtime_error(
+                "BUG: The anchors number not match the assumption of \"identify\" function"
+            );
+        }
+        auto binary = decode_(patch, anchors, thres);
+        auto [id, distance] = index.identify(binary);
+        return {id, distance};
+    }
+
+    /**
+     * @brief Decode the markers by sampling the anchors straight from the patch 
+     *        (see to_binary_direct_) instead of building a temporary cell image.
+     * 
+     * @param flag  Enable the direct decoder, default is false.
+     */
+    void set_direct_decode(bool flag) {
+        direct_decode_ = flag;
+    }
+    /**
+     * @brief Decode the coding bits of a marker patch, by the decoder selected 
+     *        with set_direct_decode.
+     * 
+     * @param patch     The marker patch, 8-bit.
+     * @param anchors   The cell centers in the patch, see RandomBased::anchors.
+     * @param thres     The minimum number of foreground pixels of a 1 bit cell.
+     */
+    std::uint64_t decode(
+        const cv::Mat&                  patch, 
+        const std::vector<cv::Vec2f>&   anchors,
+        const int                       thres = 3
+    ) const {
+        return decode_(patch, anchors, thres);
+    }
+
     auto operator()(
         cv::Mat                  input, 
         const std::vector<int>&  active_ids,
         const int                thres = 3
     ) const {
-        return Base::operator()(input, active_ids, thres);
+        auto index = dict_index(active_ids);
+        return Base::operator()(input, *index, thres);
+    }
+    /**
+     * @brief Detect on a FOV pyramid shared by other detectors, 
+     *        see RandomBased::operator() for the pyramid requirement.
+     */
+    auto operator()(
+        const algo::ImagePyramid&   pyramid, 
+        const std::vector<int>&     active_ids,
+        const int                   thres = 3
+    ) const {
+        auto index = dict_index(active_ids);
+        return Base::operator()(pyramid, *index, thres);
     }
 private:
+    /**
+     * @brief The search index of the active IDs, rebuilt only when the list changes.
+     */
+    std::shared_ptr<const aruco::DictionaryIndex> dict_index(
+        const std::vector<int>& active_ids
+    ) const {
+        std::lock_guard<std::mutex> lock(index_cache_->mux);
+        auto& index = index_cache_->index;
+        if(!index || index->candidates() != active_ids) {
+            index = std::make_shared<const aruco::DictionaryIndex>(*dict_, active_ids);
+        }
+        return index;
+    }
+    struct IndexCache {
+        std::mutex                                      mux     ;
+        std::shared_ptr<const aruco::DictionaryIndex>   index   ;
+    };
     aruco::ConstDictionaryPtr   dict_         ;
     int                         ext_width_    ;
+    std::shared_ptr<IndexCache> index_cache_  ;
+    bool                        direct_decode_{false};
 };
 
 struct MakeArucoRandom {
@@ -11,6 +11,7 @@
 #include <ChipImgProc/marker/layout.hpp>
 #include <ChipImgProc/marker/detection/mk_region.hpp>
 #include <ChipImgProc/aruco.hpp>
+#include <ChipImgProc/algo/image_pyramid.hpp>
 #include "reg_mat.hpp"
 #include "aruco_random.hpp"
 namespace chipimgproc::marker::detection {
@@ -80,13 +81,33 @@ class ArucoRegMat {
         }
         return marker_regions;
     }
-    auto resize(cv::Mat& img, std::int32_t pyramid_level) const {
-        cv::Mat img_tmp; 
-        for( int i = 0; i < pyramid_level; i ++ ) {
-            cv::pyrDown(img, img_tmp);
-            img = img_tmp.clone();
+    template<class Results>
+    std::vector<MKRegion> to_regions(
+        const Results&  results,
+        int             marker_width,
+        int             marker_height
+    ) const {
+        std::vector<MKRegion> regions;
+        auto top = std::distance(
+            results.begin()
+          , std::find_if(results.begin(), results.end(), [](auto&& tuple) {
+                return std::get<0>(tuple) == -1;
+            })
+        );
+        for (auto k = 0; k < top; ++k) {
+            auto&& [idx, score, loc] = results.at(k);
+            auto pos = layout_.get_sub(idx);
+            MKRegion mk;
+            mk.x = std::round(loc.x - (marker_width  - 1) * 0.5);
+            mk.y = std::round(loc.y - (marker_height - 1) * 0.5);
+            mk.width = marker_width;
+            mk.height = marker_height;
+            mk.x_i = pos.x;
+            mk.y_i = pos.y;
+            mk.score = score;
+            regions.push_back(std::move(mk));
         }
-        
+        return regions;
     }
 public:
 
@@ -124,28 +145,27 @@ public:
         const ViewerCallback&       v_search   = nullptr,
         const ViewerCallback&       v_marker   = nullptr
     ) const {
-        std::vector<MKRegion> regions;
         auto results = detector_(src, layout_.get_marker_indices());
-        auto top = std::distance(
-            results.begin()
-          , std::find_if(results.begin(), results.end(), [](auto&& tuple) {
-                return std::get<0>(tuple) == -1;
-            })
-        );
-        for (auto k = 0; k < top; ++k) {
-            auto&& [idx, score, loc] = results.at(k);
-            auto pos = layout_.get_sub(idx);
-            MKRegion mk;
-            mk.x = std::round(loc.x - (marker_width  - 1) * 0.5);
-            mk.y = std::round(loc.y - (marker_height - 1) * 0.5);
-            mk.width = marker_width;
-            mk.height = marker_height;
-            mk.x_i = pos.x;
-            mk.y_i = pos.y;
-            mk.score = score;
-            regions.push_back(std::move(mk));
-        }
-        return regions;
+        return to_regions(results, marker_width, marker_height);
+    }
+    /**
+     * @brief Call operator, detect ArUco marker as regular matrix on a FOV pyramid 
+     *        shared by other detectors, see RandomBased::operator() for the pyramid 
+     *        requirement.
+     * 
+     * @param pyramid           The input image pyramid.
+     * @param marker_width      Marker width in pixel scale.
+     * @param marker_height     Marker height in pixel scale.
+     * @return std::vector<MKRegion> 
+     *                          The detected marker regions.
+     */
+    std::vector<MKRegion> operator()(
+        const algo::ImagePyramid&   pyramid, 
+        int                         marker_width,
+        int                         marker_height
+    ) const {
+        auto results = detector_(pyramid, layout_.get_marker_indices());
+        return to_regions(results, marker_width, marker_height);
     }
 
     /**
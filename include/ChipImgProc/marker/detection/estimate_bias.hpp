@@ -6,7 +6,9 @@
 #include <ChipImgProc/utils.h>
 #include <algorithm>
 #include <ChipImgProc/rotation/from_warp_mat.hpp>
+#include <ChipImgProc/algo/fft_match_template.hpp>
 #include <cmath>
+#include <memory>
 // #include <iostream>
 namespace chipimgproc::marker::detection {
 /**
@@ -98,6 +100,9 @@ public:
         typed_mat(_image, [&image](auto&& mat){
             image = norm_u8(mat);
         });
+        // the key of the kept matcher, the template and mask before the rotation
+        const cv::Mat src_templ = templ;
+        const cv::Mat src_mask  = mask;
         auto h = templ.rows;
         auto w = templ.cols;
         auto templ_center = cv::Point2d(
@@ -107,6 +112,17 @@ public:
         auto rot_mat = cv::getRotationMatrix2D(templ_center, angle, 1.0);
         templ = warp_affine_u8(templ, rot_mat, {w, h});
         mask = warp_affine_u8(mask, rot_mat, {w, h});
+        // the same template is matched on every FOV and hint cover, the matcher is kept
+        algo::FFTMatchTemplate fft_match;
+        if(fft_cache_) {
+            fft_match = fft_cache_->get(src_templ, src_mask, angle, [&](){
+                return algo::FFTMatchTemplate(templ, mask);
+            });
+        }
+        auto match = [&](const cv::Mat& img) -> cv::Mat_<float> {
+            if(fft_cache_) return fft_match(img);
+            return chipimgproc::match_template(img, templ, cv::TM_CCORR_NORMED, mask);
+        };
 
         int x0, y0, x1, y1;
         cv::Size2d cover_size;        
@@ -158,12 +174,12 @@ public:
                 // score.convertTo(tmp, CV_8U, 255);
                 // cv::imwrite("score-" + std::to_string(h.x) + "-" + std::to_string(h.y) + ".tiff", tmp);
                 // scores += score;
-                scores += chipimgproc::match_template(cover, templ, cv::TM_CCORR_NORMED, mask);
+                scores += match(cover);
             }
         }
         else {
             // Original: Original cover center (for match_template score domain) (*)
-            auto score_matrix = chipimgproc::match_template(image, templ, cv::TM_CCORR_NORMED, mask);
+            auto score_matrix = match(image);
             cv::Point2f center;
 
             scores.create(cover_size, cv::Mat1f().type());
@@ -319,8 +335,34 @@ public:
             regulation_cover_size
         );
     }
+    /**
+     * @brief Match the rotated template by FFT cross correlation (see algo::FFTMatchTemplate)
+     *        instead of cv::matchTemplate. The matchers are kept across calls, keyed by the 
+     *        template, the mask and the angle (see algo::FFTMatchTemplateCache), so the 
+     *        spectra of each search size are computed once for all FOVs and hint covers. 
+     *        Copies of the object share the matchers. The scores are the same up to 
+     *        float rounding.
+     * 
+     * @param flag  Enable the FFT matching, default is false. Setting it again drops 
+     *              the kept matchers.
+     */
+    void set_fft_match(bool flag) {
+        fft_cache_ = flag ? std::make_shared<algo::FFTMatchTemplateCache>() : nullptr;
+    }
+    bool fft_match() const {
+        return fft_cache_ != nullptr;
+    }
+    /**
+     * @brief The kept FFT matchers, nullptr if the FFT matching is disabled.
+     */
+    const std::shared_ptr<algo::FFTMatchTemplateCache>& fft_cache() const {
+        return fft_cache_;
+    }
+private:
+    std::shared_ptr<algo::FFTMatchTemplateCache> fft_cache_ {nullptr};
 };
 
-constexpr EstimateBias estimate_bias;
+// not constexpr, the kept FFT matchers are not a literal type
+inline const EstimateBias estimate_bias;
 
 }
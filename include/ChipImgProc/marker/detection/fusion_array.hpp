@@ -12,6 +12,8 @@
 #include <opencv2/video.hpp>
 #include <opencv2/video/tracking.hpp>
 #include <ChipImgProc/utils.h>
+#include <ChipImgProc/algo/fft_match_template.hpp>
+#include <ChipImgProc/algo/image_pyramid.hpp>
 #include <ChipImgProc/marker/layout.hpp>
 #include <ChipImgProc/const.h>
 #include <ChipImgProc/marker/detection/mk_region.hpp>
@@ -223,6 +225,24 @@ public:
             return img;
         };
     }
+    /**
+     * @brief Match the templates by FFT cross correlation with the template
+     *        spectra cached (see algo::FFTMatchTemplate), instead of
+     *        cv::matchTemplate on every call. The scores are the same up to
+     *        float rounding.
+     * 
+     * @param flag  Enable the FFT matching, default is false.
+     */
+    void set_fft_match(bool flag) {
+        fft_match_ = flag;
+        if(fft_match_) {
+            match_  = algo::FFTMatchTemplate(templ_,  mask_,  method_);
+            smatch_ = algo::FFTMatchTemplate(stempl_, smask_, method_);
+        } else {
+            match_  = algo::FFTMatchTemplate();
+            smatch_ = algo::FFTMatchTemplate();
+        }
+    }
     /**
      * @brief     This function perform the FusionArray detection technique algorithm 
      *            to recognize the positions of each general marker.
@@ -235,35 +255,44 @@ public:
     > operator() (
         cv::Mat input
     ) const {
-        // Convert input image to CV_8U
-        cvMat8 image;
-        if (input.depth() == CV_8U)
-            input.copyTo(image);
-        else if (input.depth() == CV_16U)
-            input.convertTo(image, CV_8U, 255.0 / theor_max_val_);
-        else 
-            throw std::invalid_argument("Invalid input image format detected.");
-
-        // Preprocess input images.        
-        image = img_preprocessor_(image);
-        // cv::imwrite("processed_fluo_image.tiff", image);
+        // Convert input image to CV_8U, preprocess and downsample it.
+        algo::ImagePyramid pyramid(
+            input, pyramid_level_, theor_max_val_, img_preprocessor_
+        );
+        return operator()(pyramid);
+    }
+    /**
+     * @brief     Same as the image version, on a pyramid shared by other detectors.
+     *            The marker regions are views of the pyramid levels.
+     * @param     pyramid   The FOV pyramid with at least pyramid_level levels, 
+     *                      normalized by theor_max_val and preprocessed as 
+     *                      the image preprocessor of this detector does.
+     */
+    std::vector<
+        std::tuple<cv::Point, double, cv::Point2d>
+    > operator() (
+        const algo::ImagePyramid& pyramid
+    ) const {
+        if (pyramid.levels() < pyramid_level_)
+            throw std::invalid_argument("The pyramid has less levels than pyramid_level.");
+        const cvMat8& image = pyramid.level(0);
 
         // int t = 0;
         std::vector<std::tuple<cv::Point, double, cv::Point2d>> results;
         // Divide the image into subarea.
         for(auto& mk_r : marker_regions_) {
-            cv::Mat target = image(mk_r);
-            // Pyramid downsampling.
-            cvMat8 starget = target.clone();
-            for (auto i = 0; i < this->pyramid_level_; ++i)
-                cv::pyrDown(starget, starget);
+            // The downsampled subarea, and its offset to the marker region.
+            auto srect = pyramid.region_rect(pyramid_level_, mk_r);
+            cvMat8 starget = pyramid.level(pyramid_level_)(srect);
+            const int dx = srect.x * s_ - mk_r.x;
+            const int dy = srect.y * s_ - mk_r.y;
             {
                 auto tmp = starget(cv::Rect(1, 1, starget.cols - 2, starget.rows - 2));
                 starget = tmp;
             }
 
             // Search all possible marker locations (template matching on downsampling domain).
-            auto match1 = cm::match_template(starget, stempl_, method_, smask_);
+            auto match1 = match_template(starget, true);
             cv::Point loc;
             cv::minMaxLoc(match1, nullptr, nullptr, nullptr, &loc);
 
@@ -275,8 +304,8 @@ public:
                 double map_buffer_r = 2.0; // 1.0 stands for no buffer area.
                 auto w = templ_.cols + (2 * s_);
                 auto h = templ_.rows + (2 * s_);
-                auto x = loc.x * s_ - std::round((map_buffer_r / 2 - 0.5) * w);
-                auto y = loc.y * s_ - std::round((map_buffer_r / 2 - 0.5) * h);
+                auto x = loc.x * s_ + dx - std::round((map_buffer_r / 2 - 0.5) * w);
+                auto y = loc.y * s_ + dy - std::round((map_buffer_r / 2 - 0.5) * h);
 
                 cvMat8 patch;
                 bool top_out, bottom_out, left_out, right_out;
@@ -292,7 +321,7 @@ public:
                     patch = image(cv::Rect(mk_r.x + x, mk_r.y + y, map_buffer_r * w, map_buffer_r * h));
                 }
 
-                auto match2 = cm::match_template(patch, templ_, method_, mask_);
+                auto match2 = match_template(patch, false);
 
                 cv::Point dxy;
                 cv::minMaxLoc(match2, nullptr, &score, nullptr, &dxy);
@@ -322,6 +351,15 @@ public:
         return results;
     }
 
+protected:
+    cv::Mat_<float> match_template(const cv::Mat& img, bool scaled) const {
+        if(fft_match_) {
+            return scaled ? smatch_(img) : match_(img);
+        }
+        return scaled
+            ? chipimgproc::match_template(img, stempl_, method_, smask_)
+            : chipimgproc::match_template(img, templ_,  method_, mask_);
+    }
 protected:
     cv::Mat_<cvMatT>                          templ_, stempl_   ;
     cv::Mat_<cvMatT>                          mask_,   smask_   ;
@@ -333,6 +371,8 @@ protected:
     std::int32_t                              s_                ;
     std::function<cvMat8(const cvMat8&)>      img_preprocessor_ ;
     double                                    theor_max_val_    ;
+    bool                                      fft_match_        {false};
+    algo::FFTMatchTemplate                    match_, smatch_   ;
 };
 
 struct MakeFusionArray {
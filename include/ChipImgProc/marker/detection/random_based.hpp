@@ -12,10 +12,14 @@
 #include <opencv2/video.hpp>
 #include <opencv2/video/tracking.hpp>
 #include <ChipImgProc/utils.h>
+#include <ChipImgProc/algo/fft_match_template.hpp>
+#include <ChipImgProc/algo/block_parallel.hpp>
+#include <ChipImgProc/algo/image_pyramid.hpp>
 #include <Nucleona/language.hpp>
 #include <ChipImgProc/logger.hpp>
 
 #include <iostream>
+#include <optional>
 
 namespace chipimgproc::marker::detection {
 
@@ -152,6 +156,15 @@ public:
     const auto& stempl() {
         return stempl_;
     }
+    /**
+     * @brief Provide the decoding anchors in the template, the cell centers 
+     *        followed by the template center.
+     * 
+     * @return auto 
+     */
+    const auto& anchors() const {
+        return anchors_;
+    }
     /**
      * @brief Set the termination criteria of the ECC algorithm (in OpenCV) used in this class.
      * 
@@ -161,6 +174,40 @@ public:
     void set_term_criteria(cv::TermCriteria tc) {
         criteria_ = tc;
     }
+    /**
+     * @brief Refine the marker candidates in parallel with thread_num threads,
+     *        by default 1 (serial). The results are the same as the serial mode.
+     * 
+     * @param thread_num    The number of worker threads.
+     */
+    void set_thread_num(int thread_num) {
+        thread_num_ = std::max(thread_num, 1);
+    }
+    /**
+     * @brief Refine the marker candidates on a shared executor instead of 
+     *        creating its own threads, nullptr to use set_thread_num.
+     */
+    void set_executor(algo::BlockExecutor executor) {
+        executor_ = std::move(executor);
+    }
+    /**
+     * @brief Match the templates by FFT cross correlation with the template
+     *        spectra cached (see algo::FFTMatchTemplate), instead of
+     *        cv::matchTemplate on every call. The scores are the same up to
+     *        float rounding.
+     * 
+     * @param flag  Enable the FFT matching, default is false.
+     */
+    void set_fft_match(bool flag) {
+        fft_match_ = flag;
+        if(fft_match_) {
+            match_  = algo::FFTMatchTemplate(templ_,  mask_,  method_);
+            smatch_ = algo::FFTMatchTemplate(stempl_, smask_, method_);
+        } else {
+            match_  = algo::FFTMatchTemplate();
+            smatch_ = algo::FFTMatchTemplate();
+        }
+    }
     /**
      * @brief     This function perform the RandomBased detection technique algorithm 
      *            to recognize the positions of each ArUco marker.
@@ -174,34 +221,36 @@ public:
     std::vector<
         std::tuple<int, double, cv::Point2d>
     > operator()(cv::Mat input, Args&&... identify_args) const {
-        // convert input to 8U image
-        cv::Mat_<uint8_t> image;
-        if (input.depth() == CV_8U)
-            input.copyTo(image);
-        else if (input.depth() == CV_16U)
-            input.convertTo(image, CV_8U, 255.0 / theor_max_val_);
-        else // invalid input format
-            throw std::invalid_argument("Invalid input format");
-        
-        // roughly fix defects
-        image = cv::max(image, cv::mean(image)[0]);
-
-        // apply pyramid downsampling
-        cv::Mat_<uint8_t> simage = image.clone();
-        for (auto i = 0; i < this->pyramid_level_; ++i)
-            cv::pyrDown(simage, simage);
+        // convert input to 8U image, roughly fix defects and apply pyramid downsampling
+        algo::ImagePyramid pyramid(
+            input, pyramid_level_, theor_max_val_, 
+            algo::ImagePyramid::clip_to_mean
+        );
+        return operator()(pyramid, FWD(identify_args)...);
+    }
+    /**
+     * @brief     Same as the image version, on a pyramid shared by other detectors.
+     * 
+     * @param     pyramid   The FOV pyramid with at least pyramid_level levels, 
+     *                      normalized by theor_max_val and clipped to the mean
+     *                      (algo::ImagePyramid::clip_to_mean), as the image version does.
+     */
+    template<class... Args>
+    std::vector<
+        std::tuple<int, double, cv::Point2d>
+    > operator()(const algo::ImagePyramid& pyramid, Args&&... identify_args) const {
+        if (pyramid.levels() < pyramid_level_)
+            throw std::invalid_argument("The pyramid has less levels than pyramid_level");
+        const cv::Mat_<uint8_t>& image = pyramid.level(0);
+        cv::Mat_<uint8_t> simage = pyramid.level(pyramid_level_);
         {
             auto tmp = simage(cv::Rect(1, 1, simage.cols - 2, simage.rows - 2));
             simage = tmp;
         }
 
         // search all possible marker locations
-        auto best_score = 0.0;
-        cv::Mat_<std::uint8_t> new_templ;
-        std::vector<cv::Point> locations;
-        std::vector<cv::Vec2f> new_anchors;
-        auto match1 = chipimgproc::match_template(simage, stempl_, method_, smask_);
-        
+        auto match1 = match_template(simage, true);
+        std::vector<std::pair<cv::Point, double>> coarse;
         for (auto i = 0; i != nms_count_; ++i) {
             // pixel-level roughly search
             cv::Point loc;
@@ -209,9 +258,24 @@ public:
             cv::minMaxLoc(match1, nullptr, &score, nullptr, &loc);
             log.debug("[Random_Based] #{}: roughly-search({}, {}, {})", i, score, loc.x, loc.y);
             cv::circle(match1, loc, nms_radius_, 0, -1);
+            coarse.emplace_back(loc, score);
+        }
 
+        // refine a candidate, the ECC and decoding are skipped 
+        // when the fine score is not better than best_score
+        struct Candidate {
+            bool                    in_range    {false};
+            cv::Point               location    ;
+            double                  score       {0};
+            int                     index       {-1};
+            cv::Mat_<std::uint8_t>  view        ;
+            std::vector<cv::Vec2f>  anchors     ;
+        };
+        auto refine = [&](int i, double best_score) {
+            Candidate cand;
             // pixel-level finely search
             {
+                auto [loc, score] = coarse[i];
                 auto x = loc.x * s_;
                 auto y = loc.y * s_;
                 auto h = templ_.rows + (2 * s_);
@@ -222,28 +286,28 @@ public:
                                 "Rect range out of image size. Continue\n"
                                 "**************************************\n", 
                                 __FILE__, __LINE__);
-                    continue;
+                    return cand;
                 }
                 auto patch = image(cv::Rect(x, y, w, h));
-                auto match2 = chipimgproc::match_template(patch, templ_, method_, mask_);
+                auto match2 = match_template(patch, false);
 
                 cv::Point dxy;
                 cv::minMaxLoc(match2, nullptr, &score, nullptr, &dxy);
                 log.debug("[Random_Based] #{}: finely-search({}, {}, {})", i, score, loc.x, loc.y);
-                locations.push_back(cv::Point(dxy.x + x, dxy.y + y));
+                cand.in_range = true;
+                cand.location = cv::Point(dxy.x + x, dxy.y + y);
+                cand.score    = score;
 
                 // filter bad identifications out
                 if (best_score >= score)
-                    continue;
+                    return cand;
             }
 
             // evaluate transformation matrix
             std::vector<cv::Vec2f> anchors;
-            auto x = locations.back().x;
-            auto y = locations.back().y;
             auto w = templ_.cols;
             auto h = templ_.rows;
-            auto view = image(cv::Rect(x, y, w, h));
+            auto view = image(cv::Rect(cand.location.x, cand.location.y, w, h));
             try {
                 cv::Matx23f wmatx = cv::Matx23f::eye();
                 cv::findTransformECC(
@@ -254,17 +318,41 @@ public:
                 cv::invertAffineTransform(wmatx, wmatx);
                 cv::transform(anchors_, anchors, wmatx);
             } catch (...) {
-                continue;
+                return cand;
             }
 
             // decoding
-            auto [index, distance] = derived()->identify(view, anchors, FWD(identify_args)...);
+            auto [index, distance] = derived()->identify(view, anchors, identify_args...);
+            cand.index   = index;
+            cand.view    = view;
+            cand.anchors = std::move(anchors);
+            return cand;
+        };
+
+        // The serial mode refines the candidates in order with the current best score,
+        // the parallel mode refines all candidates first and picks the same one:
+        // the first decoded candidate with the highest score.
+        std::vector<Candidate> cands(coarse.size());
+        if (parallel()) {
+            run(cands.size(), [&](int i) { cands[i] = refine(i, 0.0); });
+        }
+        auto best_score = 0.0;
+        cv::Mat_<std::uint8_t> new_templ;
+        std::vector<cv::Point> locations;
+        std::vector<cv::Vec2f> new_anchors;
+        for (std::size_t i = 0; i < cands.size(); ++i) {
+            if (!parallel())
+                cands[i] = refine(i, best_score);
+            auto& cand = cands[i];
+            if (!cand.in_range) 
+                continue;
+            locations.push_back(cand.location);
 
             // set new template and anchors for decoding
-            if( index >= 0) {
-                best_score = score;
-                new_templ = view;
-                new_anchors = anchors;
+            if (cand.index >= 0 && best_score < cand.score) {
+                best_score = cand.score;
+                new_templ = cand.view;
+                new_anchors = cand.anchors;
             }
         }
         
@@ -273,10 +361,12 @@ public:
         }
 
         // identify marker locations with new template
-        std::vector<std::tuple<int, double, cv::Point2d>> results;
+        using Result = std::tuple<int, double, cv::Point2d>;
+        std::vector<std::optional<Result>> founds(locations.size());
         auto h = new_templ.rows;
         auto w = new_templ.cols;
-        for(auto&& [x, y] : locations) {
+        run(locations.size(), [&](int i) {
+            auto [x, y] = locations[i];
     
             // subpixel-level search
             auto view = image(cv::Rect(x, y, w, h));
@@ -284,10 +374,6 @@ public:
             double score = 0.0;
             cv::Point2d center;
             try {
-                // std::string str("(" + std::to_string(fov_id.x) + "," + std::to_string(fov_id.y) + ")-" + std::to_string(i) + "-(" + std::to_string(x) + "," + std::to_string(y) + ").tiff");
-                // cv::imwrite("view" + str, view);
-                // cv::imwrite("new_templ" + str, new_templ);
-                // cv::imwrite("mask" + str, mask_);
                 score = cv::findTransformECC(
                     view, new_templ, wmatx, 
                     cv::MOTION_TRANSLATION, criteria_, mask_
@@ -295,22 +381,25 @@ public:
                 center.x = x + new_anchors.back()[0] - wmatx(0, 2);
                 center.y = y + new_anchors.back()[1] - wmatx(1, 2);
             } catch(...) {
-                continue;
+                return;
             }
-            // cv::imwrite("view.png", view);
             // decoding
             auto [index, distance] = derived()->identify(
                 view, 
                 new_anchors, 
-                FWD(identify_args)...
+                identify_args...
             );
 
             // save result
-            results.emplace_back(index, score, center);
-            // ++i;
+            founds[i].emplace(index, score, center);
+        });
+        std::vector<Result> results;
+        for(auto&& r : founds) {
+            if(r) results.push_back(std::move(*r));
         }
 
-        std::sort(results.begin(), results.end(), [](auto&& r0, auto&& r1){
+        // stable, the ties keep the location order in both modes
+        std::stable_sort(results.begin(), results.end(), [](auto&& r0, auto&& r1){
             auto&& [i0, s0, c0] = r0;
             auto&& [i1, s1, c1] = r1;
             if(i0 != i1) return i0 > i1;
@@ -320,6 +409,30 @@ public:
 
         return results;
     }
+protected:
+    bool parallel() const {
+        return executor_ || thread_num_ > 1;
+    }
+    template<class Job>
+    void run(std::size_t n, Job&& job) const {
+        auto body = [&job](int blk, int beg, int end) {
+            for(int i = beg; i < end; i ++) job(i);
+        };
+        if(!parallel()) {
+            body(0, 0, n);
+            return;
+        }
+        auto executor = executor_ ? executor_ : algo::make_block_executor(thread_num_);
+        executor(n, body);
+    }
+    cv::Mat_<float> match_template(const cv::Mat& img, bool scaled) const {
+        if(fft_match_) {
+            return scaled ? smatch_(img) : match_(img);
+        }
+        return scaled
+            ? chipimgproc::match_template(img, stempl_, method_, smask_)
+            : chipimgproc::match_template(img, templ_,  method_, mask_);
+    }
 protected:
     cv::Mat_<std::uint8_t>  templ_, stempl_ ; 
     cv::Mat_<std::uint8_t>  mask_, smask_   ; 
@@ -331,6 +444,10 @@ protected:
     std::vector<cv::Vec2f>  anchors_        ;
     std::int32_t            s_              ;
     cv::TemplateMatchModes  method_         ;
+    bool                    fft_match_      {false};
+    algo::FFTMatchTemplate  match_, smatch_ ;
+    int                     thread_num_     {1};
+    algo::BlockExecutor     executor_       ;
 };
 
 }
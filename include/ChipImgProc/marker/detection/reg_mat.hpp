@@ -13,6 +13,8 @@
 #include <Nucleona/range.hpp>
 #include <ChipImgProc/algo/fixed_capacity_set.hpp>
 #include <ChipImgProc/utils/pos_comp_by_score.hpp>
+#include <ChipImgProc/algo/fft_match_template.hpp>
+#include <memory>
 namespace chipimgproc{ namespace marker{ namespace detection{
 /**
  *  @brief      This class, named regular matrix (RegMat), is used to
@@ -127,7 +129,15 @@ class RegMat {
                 sub_tgt.rows - mk.rows + 1,
                 sub_tgt.cols - mk.cols + 1
             );
-            cv::matchTemplate(sub_tgt, mk, sub_candi_score, cv::TM_CCORR_NORMED, mask);
+            if(fft_cache_) {
+                // the candidate markers are the same on every FOV, so are their matchers
+                auto match = fft_cache_->get(mk, mask, 0, [&](){
+                    return algo::FFTMatchTemplate(mk, mask);
+                });
+                sub_candi_score = match(sub_tgt);
+            } else {
+                cv::matchTemplate(sub_tgt, mk, sub_candi_score, cv::TM_CCORR_NORMED, mask);
+            }
             // auto tmp = norm_u8(sub_candi_score, 0, 0);
             sub_score = sub_candi_score;
             auto mk_cols = mk_des.get_std_mk(unit).cols;
@@ -219,6 +229,30 @@ public:
             }, out, v_bin, v_search, v_marker
         );
     }
+    /**
+     * @brief Match the candidate markers by FFT cross correlation (see algo::FFTMatchTemplate)
+     *        instead of cv::matchTemplate. The matchers are kept across calls, keyed by the 
+     *        candidate marker (see algo::FFTMatchTemplateCache), so the template spectra of 
+     *        each padded region size are computed once for all FOVs. Copies of the object 
+     *        share the matchers. The scores are the same up to float rounding.
+     * 
+     * @param flag  Enable the FFT matching, default is false. Setting it again drops 
+     *              the kept matchers.
+     */
+    void set_fft_match(bool flag) {
+        fft_cache_ = flag ? std::make_shared<algo::FFTMatchTemplateCache>() : nullptr;
+    }
+    bool fft_match() const {
+        return fft_cache_ != nullptr;
+    }
+    /**
+     * @brief The kept FFT matchers, nullptr if the FFT matching is disabled.
+     */
+    const std::shared_ptr<algo::FFTMatchTemplateCache>& fft_cache() const {
+        return fft_cache_;
+    }
+private:
+    std::shared_ptr<algo::FFTMatchTemplateCache> fft_cache_ {nullptr};
 };
 
 }}}
@@ -4,7 +4,9 @@
 #include <ChipImgProc/stat/mats.hpp>
 #include <ChipImgProc/tiled_mat.hpp>
 #include <map>
+#include <memory>
 #include <ChipImgProc/utils.h>
+#include <ChipImgProc/algo/fft_match_template.hpp>
 namespace chipimgproc{ namespace roi{
 struct RegMatMarkerLayout {
     cv::Mat norm_u8(const cv::Mat_<float>& m) {
@@ -98,7 +100,15 @@ struct RegMatMarkerLayout {
                     sub_tgt.rows - mk.rows + 1,
                     sub_tgt.cols - mk.cols + 1
                 );
-                cv::matchTemplate(sub_tgt, mk, sub_score, cv::TM_CCORR_NORMED);
+                if(fft_cache_) {
+                    // the candidate markers are the same on every FOV, so are their matchers
+                    auto match = fft_cache_->get(mk, cv::Mat(), 0, [&](){
+                        return algo::FFTMatchTemplate(mk);
+                    });
+                    sub_score = match(sub_tgt);
+                } else {
+                    cv::matchTemplate(sub_tgt, mk, sub_score, cv::TM_CCORR_NORMED);
+                }
                 if(v_score) {
                     cv::Mat tmp;
                     // cv::Mat tmp = sub_score + 1;
@@ -145,6 +155,30 @@ struct RegMatMarkerLayout {
         return check_res.qc_pass;
         
     }
+    /**
+     * @brief Match the candidate markers by FFT cross correlation (see algo::FFTMatchTemplate)
+     *        instead of cv::matchTemplate. The matchers are kept across calls, keyed by the 
+     *        candidate marker (see algo::FFTMatchTemplateCache). The sub regions have the 
+     *        same size, so the template spectra are computed once for all FOVs. Copies of 
+     *        the object share the matchers. The scores are the same up to float rounding.
+     * 
+     * @param flag  Enable the FFT matching, default is false. Setting it again drops 
+     *              the kept matchers.
+     */
+    void set_fft_match(bool flag) {
+        fft_cache_ = flag ? std::make_shared<algo::FFTMatchTemplateCache>() : nullptr;
+    }
+    bool fft_match() const {
+        return fft_cache_ != nullptr;
+    }
+    /**
+     * @brief The kept FFT matchers, nullptr if the FFT matching is disabled.
+     */
+    const std::shared_ptr<algo::FFTMatchTemplateCache>& fft_cache() const {
+        return fft_cache_;
+    }
+private:
+    std::shared_ptr<algo::FFTMatchTemplateCache> fft_cache_ {nullptr};
 };
 
 
@@ -34,12 +34,48 @@ struct Calibrate
         ) const
         {
             auto& src = in_src;
-            cv::Point2f center(src.cols >> 1, src.rows >> 1);
-            auto mat = cv::getRotationMatrix2D(center, theta, 1.0);
+            auto mat = rotation_matrix(src.size(), theta);
             cv::warpAffine(src, src, mat, src.size());
             if(v_result) {
                 v_result(src);
             }
         }
+        /**
+         *    @brief Render a region of the rotated image straight from the unrotated image.
+         *    @details The transform is the same as operator(), with the translation 
+         *             shifted by the region origin, so only the region pixels are 
+         *             resampled and src is not modified. The pixels mapped from outside 
+         *             of src are 0.
+         *    @param src       The unrotated image.
+         *    @param dst       The output region image, reused if the size and type match.
+         *    @param theta     The rotation angle, same as operator().
+         *    @param roi       The region in the rotated image coordinate.
+         */
+        template<class FLOAT>
+        void region(
+              const cv::Mat& src
+            , cv::Mat& dst
+            , FLOAT theta
+            , const cv::Rect& roi
+        ) const
+        {
+            if(theta == 0 && (roi & cv::Rect(0, 0, src.cols, src.rows)) == roi) {
+                src(roi).copyTo(dst);
+                return;
+            }
+            cv::Mat_<double> mat = rotation_matrix(src.size(), theta);
+            mat(0, 2) -= roi.x;
+            mat(1, 2) -= roi.y;
+            cv::warpAffine(src, dst, mat, roi.size());
+        }
+        /**
+         *    @brief The rotation matrix of operator(), rotate around the image center.
+         */
+        template<class FLOAT>
+        static cv::Mat rotation_matrix(const cv::Size& size, FLOAT theta)
+        {
+            cv::Point2f center(size.width >> 1, size.height >> 1);
+            return cv::getRotationMatrix2D(center, theta, 1.0);
+        }
 };
 }}
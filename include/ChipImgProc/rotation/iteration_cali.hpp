@@ -5,6 +5,9 @@
  * 
  */
 #pragma once
+#include <cmath>
+#include <tuple>
+#include <vector>
 #include <ChipImgProc/utils.h>
 #include <Nucleona/stream/null_buffer.hpp>
 namespace chipimgproc::rotation {
@@ -29,7 +32,18 @@ namespace chipimgproc::rotation {
  *    direct return the current estimated angle.
  * 6. Goto 1.
  * 
+ * The full resolution image is cloned and calibrated in each iteration, 
+ * which is the main cost for large images. With set_pyramid(), the iteration 
+ * runs coarse to fine instead:
  * 
+ * 1. Run the above iteration on a cv::pyrDown image, the rotation angle 
+ *    does not change with the scale.
+ * 2. Refine the angle at full resolution on a few crops, each crop is 
+ *    calibrated with the current angle and the mean of the crop estimates 
+ *    is the angle offset. The same stop conditions are used.
+ * 
+ * So the full resolution image is never warped by operator(), and 
+ * calibrate() applies the final rotation exactly once.
  */
 template<class Float, class RotEst, class RotCali>
 struct IterationCali {
@@ -74,30 +88,77 @@ struct IterationCali {
         const EstArgs& est_args = {},
         const CaliArgs& cali_args = {}
     ) const {
-        const int start_record_theta_time = 2;
-
+        if(pyramid_levels_ > 0) {
+            return coarse_to_fine(src, est_args, cali_args);
+        }
         cv::Mat tmp = src.clone();
-        Float theta_off, theta(0);
-        int iter_times = 0;
-        std::vector<Float> candi_theta;
         auto rot_est = [this, &tmp](auto&&... args) {
             return rot_est_(tmp, FWD(args)...);
         };
-        auto rot_cali = [this, &tmp, &theta](auto&&... args) {
-            return rot_cali_(tmp, theta, FWD(args)...);
-        };
+        return converge(0, [&](Float curr) {
+            Float theta_off = std::apply(rot_est, est_args);
+            tmp = src.clone();
+            calibrate_view(tmp, curr + theta_off, cali_args);
+            return theta_off;
+        });
+    }
+    /**
+     * @brief Estimate the rotation angle by operator() and calibrate the image in-place,
+     *        the rotation calibrate function is applied to src exactly once.
+     * 
+     * @param src           Input image, rotated in-place.
+     * @param est_args      Estimate function additional parameters wrap by std::tuple 
+     * @param cali_args     Calibrate function additional parameters wrap by std::tuple
+     * @return auto         Deduced, same as template parameter Float. The final result angle.
+     */
+    template<
+        class EstArgs = std::tuple<>, 
+        class CaliArgs = std::tuple<>
+    > auto calibrate(
+        cv::Mat& src, 
+        const EstArgs& est_args = {},
+        const CaliArgs& cali_args = {}
+    ) const {
+        Float theta = operator()(src, est_args, cali_args);
+        calibrate_view(src, theta, cali_args);
+        return theta;
+    }
+    /**
+     * @brief Enable the coarse to fine mode.
+     * 
+     * @param levels        The cv::pyrDown times of the coarse estimation image, 
+     *                      0 to disable the mode (default).
+     * @param crop_size     The side length of the full resolution refinement crops.
+     * @param crop_grid     The crops are centered on a crop_grid x crop_grid grid 
+     *                      over the image.
+     */
+    void set_pyramid(int levels, int crop_size = 1024, int crop_grid = 2) {
+        pyramid_levels_ = std::max(levels, 0);
+        crop_size_      = std::max(crop_size, 1);
+        crop_grid_      = std::max(crop_grid, 1);
+    }
+private:
+    /**
+     * @brief The iteration and stop conditions, 
+     *        step(theta) estimates the angle offset of the image calibrated by theta.
+     */
+    template<class Step>
+    Float converge(Float theta, Step&& step) const {
+        const int start_record_theta_time = 2;
+
+        Float theta_off;
+        int iter_times = 0;
+        std::vector<Float> candi_theta;
         do {
-            theta_off = std::apply(rot_est, est_args);
+            theta_off = step(theta);
             theta += theta_off;
-            tmp = src.clone();
-            std::apply(rot_cali, cali_args);
             if(iter_times > start_record_theta_time) {
                 candi_theta.push_back(theta);
             }
             iter_times++;
             if(iter_times >= max_time_) break;
         } while(std::abs(theta_off) > theta_threshold_);
-        if( std::abs(theta_off) > theta_threshold_ ) {
+        if( std::abs(theta_off) > theta_threshold_ && !candi_theta.empty() ) {
             // logger << "theta not converge\n";
             Float sum = 0;
             for(auto&& t : candi_theta) {
@@ -107,11 +168,84 @@ struct IterationCali {
         }
         return theta;
     }
-private:
+    template<class CaliArgs>
+    void calibrate_view(cv::Mat& img, Float theta, const CaliArgs& cali_args) const {
+        std::apply([this, &img, theta](auto&&... args) {
+            return rot_cali_(img, theta, FWD(args)...);
+        }, cali_args);
+    }
+    template<class EstArgs>
+    Float estimate(const cv::Mat& img, const EstArgs& est_args) const {
+        return std::apply([this, &img](auto&&... args) {
+            return rot_est_(img, FWD(args)...);
+        }, est_args);
+    }
+    template<class EstArgs, class CaliArgs>
+    Float coarse_to_fine(
+        const cv::Mat&  src, 
+        const EstArgs&  est_args,
+        const CaliArgs& cali_args
+    ) const {
+        // coarse
+        cv::Mat small = src;
+        for(int i = 0; i < pyramid_levels_; i ++) {
+            if(small.cols < 2 || small.rows < 2) break;
+            cv::Mat tmp;
+            cv::pyrDown(small, tmp);
+            small = tmp;
+        }
+        cv::Mat tmp = small.clone();
+        Float theta = converge(0, [&](Float curr) {
+            Float theta_off = estimate(tmp, est_args);
+            tmp = small.clone();
+            calibrate_view(tmp, curr + theta_off, cali_args);
+            return theta_off;
+        });
+
+        // fine, the crop regions are sqrt(2) times larger than the crops, 
+        // so the center crop is inside the image content after any rotation
+        std::vector<cv::Rect> regions;
+        const int region_size = std::ceil(crop_size_ * std::sqrt(2.0));
+        const cv::Rect bound(0, 0, src.cols, src.rows);
+        for(int j = 0; j < crop_grid_; j ++) {
+            for(int i = 0; i < crop_grid_; i ++) {
+                cv::Point center(
+                    (2 * i + 1) * src.cols / (2 * crop_grid_),
+                    (2 * j + 1) * src.rows / (2 * crop_grid_)
+                );
+                auto region = cv::Rect(
+                    center.x - region_size / 2, center.y - region_size / 2,
+                    region_size, region_size
+                ) & bound;
+                if(region.width < 2 || region.height < 2) continue;
+                regions.push_back(region);
+            }
+        }
+        if(regions.empty()) return theta;
+        return converge(theta, [&](Float curr) {
+            Float sum = 0;
+            for(auto&& region : regions) {
+                cv::Mat crop = src(region).clone();
+                calibrate_view(crop, curr, cali_args);
+                const int side = std::min<int>(
+                    crop_size_, 
+                    std::min(crop.cols, crop.rows) / std::sqrt(2.0)
+                );
+                sum += estimate(crop(cv::Rect(
+                    (crop.cols - side) / 2, (crop.rows - side) / 2,
+                    side, side
+                )), est_args);
+            }
+            return sum / regions.size();
+        });
+    }
     int         max_time_           ;
     Float       theta_threshold_    ;
     RotEst      rot_est_            ;
     RotCali     rot_cali_           ;
+    int         pyramid_levels_     {0};
+    int         crop_size_          {1024};
+    int         crop_grid_          {2};
 };
 /**
  * @anchor make-iteration-cali
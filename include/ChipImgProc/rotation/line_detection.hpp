@@ -142,6 +142,8 @@ class LineDetection
         }
 
         HoughTransform<FLOAT> hough_transform( min_theta, max_theta, steps );
+        hough_transform.set_thread_num( hough_thread_num_ );
+        hough_transform.set_executor( hough_executor_ );
         
         if ( !has_grid_img )
         {
@@ -218,31 +220,70 @@ class LineDetection
         if(v_edges) {
             v_edges(src);
         }
-        auto hist = hough_transform( src );
-        chipimgproc::info(msg, src);
-        cv::Point loc = min_entropy( hist, msg );
-        chipimgproc::info(msg, src);
-        // double val;
-        // cv::minMaxLoc(hist, nullptr, &val, nullptr, &loc);
-        auto theta = hough_transform.unitvecs()[loc.y].theta - 90;
-
-        msg << "theta = " << theta << '\n';
-
-        if(v_hough) {
-            cv::Mat tmp(hist.rows, hist.cols, CV_16UC1);
-            hist.forEach([&tmp](auto& p, const int* pos){
-                tmp.at<std::uint16_t>(pos[0], pos[1]) = p.load();
-            });
-            {
-                cv::Mat tmp2;
-                cv::normalize(tmp, tmp2, 0, 65535, cv::NORM_MINMAX, CV_16UC1);
-                tmp = tmp2;
+        auto detect = [&](auto&& hist) {
+            chipimgproc::info(msg, src);
+            cv::Point loc = min_entropy( hist, msg );
+            chipimgproc::info(msg, src);
+            // double val;
+            // cv::minMaxLoc(hist, nullptr, &val, nullptr, &loc);
+            auto theta = hough_transform.unitvecs()[loc.y].theta - 90;
+
+            msg << "theta = " << theta << '\n';
+
+            if(v_hough) {
+                cv::Mat tmp(hist.rows, hist.cols, CV_16UC1);
+                hist.forEach([&tmp](auto& p, const int* pos){
+                    tmp.at<std::uint16_t>(pos[0], pos[1]) = cv::saturate_cast<std::uint16_t>(get_value(p));
+                });
+                {
+                    cv::Mat tmp2;
+                    cv::normalize(tmp, tmp2, 0, 65535, cv::NORM_MINMAX, CV_16UC1);
+                    tmp = tmp2;
+                }
+                cv::line(tmp, cv::Point(0, loc.y), cv::Point(hist.cols-1, loc.y), cv::Scalar(65535));
+                v_hough(tmp);
             }
-            cv::line(tmp, cv::Point(0, loc.y), cv::Point(hist.cols-1, loc.y), cv::Scalar(65535));
-            v_hough(tmp);
+            return theta;
+        };
+        switch ( hough_engine_ )
+        {
+            case HoughEngine::private_acc:
+                return detect( hough_transform.vote( src ) );
+            case HoughEngine::simd:
+                return detect( hough_transform.vote_simd( src ) );
+            default:
+                return detect( hough_transform( src ) );
         }
-        return theta;
     }
+    /**
+     * @brief Select the voting engine of the Hough transform, see chipimgproc::HoughEngine.
+     *        By default the atomic uint16 voting of HoughTransform::operator() is used.
+     */
+    void set_hough_engine(HoughEngine engine)
+    {
+        hough_engine_ = engine;
+    }
+    /**
+     * @brief Use the exact private accumulator voting, see HoughTransform::vote.
+     *        Same as set_hough_engine(HoughEngine::private_acc).
+     */
+    void set_private_hough(bool enable)
+    {
+        hough_engine_ = enable ? HoughEngine::private_acc : HoughEngine::atomic;
+    }
+    /**
+     * @brief Set the thread number and the executor of the Hough transform,
+     *        see HoughTransform::set_thread_num and HoughTransform::set_executor.
+     */
+    void set_hough_executor(int thread_num, algo::BlockExecutor executor = nullptr)
+    {
+        hough_thread_num_ = thread_num;
+        hough_executor_   = std::move(executor);
+    }
+  private:
+    HoughEngine             hough_engine_       {HoughEngine::atomic};
+    int                     hough_thread_num_   {4};
+    algo::BlockExecutor     hough_executor_     ;
 };
 
 
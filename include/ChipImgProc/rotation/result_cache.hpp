@@ -0,0 +1,325 @@
+/**
+ * @file    result_cache.hpp
+ * @brief   @copybrief chipimgproc::rotation::ResultCache
+ */
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <ChipImgProc/utils.h>
+#include <ChipImgProc/optional.hpp>
+#include <ChipImgProc/marker/detection/mk_region.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/sync/file_lock.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+
+namespace chipimgproc{ namespace rotation{
+
+/**
+ * @brief A persistent keyed store of the FOV registration results: the rotation
+ *        angle, the warp matrix, the detected marker regions and the um to pixel rate.
+ *
+ * @details The key is the hash of the image content plus the hash of the parameters
+ *          (see make_key()), so a rerun or a parameter sweep over the same images can
+ *          skip the marker detection and the rotation estimation.
+ *
+ *          The store is one append-only binary file. Each record is
+ *          [magic, payload size, key, payload, checksum], and a later record of the
+ *          same key replaces the earlier one. The file is memory-mapped for reading
+ *          and indexed by key, new records (also from other processes) are indexed
+ *          the next time a key is not found.
+ *
+ *          Concurrency:
+ *          - One object can be shared by the threads of a process, the lookups share
+ *            a reader lock and the index refresh and the saves are exclusive.
+ *            Use one object per file in a process, the file lock is per process.
+ *          - Between processes, the appends are serialized by a file lock on
+ *            "<path>.lock". Readers take no file lock, a record is only accepted
+ *            after its size and checksum are verified, so a record being written
+ *            is ignored until it is complete. A torn tail left by a crashed writer
+ *            is truncated by the next save.
+ *
+ *          The records are in the native byte order, the file is not portable
+ *          between platforms of different endianness.
+ *
+ *          This replaces the text file chipimgproc::rotation::Cache, which only
+ *          stores the rotation angle.
+ */
+struct ResultCache {
+    /**
+     * @brief The store key, the image content hash and the parameter hash.
+     */
+    struct Key {
+        std::uint64_t image {0};
+        std::uint64_t param {0};
+        bool operator==(const Key& k) const {
+            return image == k.image && param == k.param;
+        }
+    };
+    /**
+     * @brief A cached result.
+     */
+    struct Entry {
+        double                                      theta   {0};    ///< rotation angle in degree
+        double                                      um2px_r {-1};   ///< um to pixel rate, negative if unknown
+        cv::Mat_<double>                            warp_mat;       ///< warp matrix, empty if unknown
+        std::vector<marker::detection::MKRegion>    markers ;       ///< detected marker regions
+    };
+
+    /**
+     * @brief Open or create the store file.
+     */
+    explicit ResultCache(boost::filesystem::path path)
+    : path_     (std::move(path))
+    , lock_path_(path_.string() + ".lock")
+    {
+        if(!boost::filesystem::exists(lock_path_)) {
+            std::ofstream touch(lock_path_.string(), std::ios::binary | std::ios::app);
+        }
+        file_lock_ = boost::interprocess::file_lock(lock_path_.string().c_str());
+        boost::interprocess::scoped_lock<boost::interprocess::file_lock> flock(file_lock_);
+        if(!boost::filesystem::exists(path_) || boost::filesystem::file_size(path_) < sizeof(file_magic)) {
+            std::ofstream fout(path_.string(), std::ios::binary | std::ios::trunc);
+            fout.write(file_magic, sizeof(file_magic));
+        } else {
+            char magic[sizeof(file_magic)];
+            std::ifstream fin(path_.string(), std::ios::binary);
+            fin.read(magic, sizeof(magic));
+            if(std::memcmp(magic, file_magic, sizeof(file_magic)) != 0) {
+                throw std::runtime_error("ResultCache: not a result cache file: " + path_.string());
+            }
+        }
+    }
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    /**
+     * @brief Hash the image size, type and pixel content.
+     */
+    static std::uint64_t hash_image(const cv::Mat& img) {
+        std::uint64_t h = fnv_offset;
+        h = hash_bytes(h, &img.rows, sizeof(img.rows));
+        h = hash_bytes(h, &img.cols, sizeof(img.cols));
+        auto type = img.type();
+        h = hash_bytes(h, &type, sizeof(type));
+        const auto row_bytes = img.cols * img.elemSize();
+        for(int r = 0; r < img.rows; r ++) {
+            h = hash_bytes(h, img.ptr(r), row_bytes);
+        }
+        return h;
+    }
+    /**
+     * @brief Hash a parameter description, e.g. the chip type and the process options.
+     */
+    static std::uint64_t hash_param(const std::string& param) {
+        return hash_bytes(fnv_offset, param.data(), param.size());
+    }
+    static Key make_key(const cv::Mat& img, const std::string& param) {
+        return Key{hash_image(img), hash_param(param)};
+    }
+
+    /**
+     * @brief Find the latest result of the key.
+     */
+    std::optional<Entry> find(const Key& key) const {
+        {
+            std::shared_lock<std::shared_mutex> lock(mux_);
+            auto itr = index_.find(key);
+            if(itr != index_.end()) {
+                return decode(itr->second);
+            }
+        }
+        std::unique_lock<std::shared_mutex> lock(mux_);
+        refresh();
+        auto itr = index_.find(key);
+        if(itr == index_.end()) return std::nullopt;
+        return decode(itr->second);
+    }
+    /**
+     * @brief Append a result, replaces the previous result of the same key.
+     */
+    void save(const Key& key, const Entry& entry) {
+        auto record = encode(key, entry);
+        std::unique_lock<std::shared_mutex> lock(mux_);
+        boost::interprocess::scoped_lock<boost::interprocess::file_lock> flock(file_lock_);
+        refresh();
+        if(boost::filesystem::file_size(path_) > valid_end_) {
+            boost::filesystem::resize_file(path_, valid_end_);
+        }
+        {
+            std::ofstream fout(path_.string(), std::ios::binary | std::ios::app);
+            fout.write(record.data(), record.size());
+            fout.flush();
+            if(!fout) {
+                throw std::runtime_error("ResultCache: write failed: " + path_.string());
+            }
+        }
+        refresh();
+    }
+    /**
+     * @brief The number of distinct keys indexed.
+     */
+    std::size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(mux_);
+        return index_.size();
+    }
+private:
+    struct KeyHash {
+        std::size_t operator()(const Key& k) const {
+            return k.image ^ (k.param * 0x9e3779b97f4a7c15ULL);
+        }
+    };
+    struct Location {
+        std::shared_ptr<boost::interprocess::mapped_region> region;
+        std::size_t                                         offset;
+        std::uint32_t                                       size;
+    };
+    static constexpr char           file_magic[8]   = {'C', 'I', 'P', 'R', 'C', 'H', '0', '1'};
+    static constexpr std::uint32_t  record_magic    = 0x43524352; // "RCRC"
+    static constexpr std::uint64_t  fnv_offset      = 14695981039346656037ULL;
+    static constexpr std::uint64_t  fnv_prime       = 1099511628211ULL;
+    static constexpr std::size_t    record_head     = 2 * sizeof(std::uint32_t) + 2 * sizeof(std::uint64_t);
+
+    /**
+     * @brief FNV-1a over 8-byte words, then over the remaining bytes.
+     */
+    static std::uint64_t hash_bytes(std::uint64_t h, const void* data, std::size_t n) {
+        auto* p = static_cast<const unsigned char*>(data);
+        std::size_t i = 0;
+        for(; i + sizeof(std::uint64_t) <= n; i += sizeof(std::uint64_t)) {
+            std::uint64_t w;
+            std::memcpy(&w, p + i, sizeof(w));
+            h = (h ^ w) * fnv_prime;
+        }
+        for(; i < n; i ++) {
+            h = (h ^ p[i]) * fnv_prime;
+        }
+        return h;
+    }
+    template<class T>
+    static void put(std::vector<char>& buf, const T& v) {
+        auto* p = reinterpret_cast<const char*>(&v);
+        buf.insert(buf.end(), p, p + sizeof(T));
+    }
+    template<class T>
+    static T get(const char*& p) {
+        T v;
+        std::memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return v;
+    }
+    static std::vector<char> encode(const Key& key, const Entry& entry) {
+        std::vector<char> payload;
+        put(payload, entry.theta);
+        put(payload, entry.um2px_r);
+        put(payload, static_cast<std::int32_t>(entry.warp_mat.rows));
+        put(payload, static_cast<std::int32_t>(entry.warp_mat.cols));
+        for(int r = 0; r < entry.warp_mat.rows; r ++) {
+            for(int c = 0; c < entry.warp_mat.cols; c ++) {
+                put(payload, entry.warp_mat(r, c));
+            }
+        }
+        put(payload, static_cast<std::uint32_t>(entry.markers.size()));
+        for(auto&& mk : entry.markers) {
+            put(payload, static_cast<std::int32_t>(mk.x));
+            put(payload, static_cast<std::int32_t>(mk.y));
+            put(payload, static_cast<std::int32_t>(mk.width));
+            put(payload, static_cast<std::int32_t>(mk.height));
+            put(payload, static_cast<std::int32_t>(mk.x_i));
+            put(payload, static_cast<std::int32_t>(mk.y_i));
+            put(payload, mk.score);
+        }
+        std::vector<char> record;
+        record.reserve(record_head + payload.size() + sizeof(std::uint64_t));
+        put(record, record_magic);
+        put(record, static_cast<std::uint32_t>(payload.size()));
+        put(record, key.image);
+        put(record, key.param);
+        record.insert(record.end(), payload.begin(), payload.end());
+        put(record, hash_bytes(fnv_offset, record.data(), record.size()));
+        return record;
+    }
+    static Entry decode(const Location& loc) {
+        auto* p = static_cast<const char*>(loc.region->get_address())
+            + loc.offset + record_head;
+        Entry entry;
+        entry.theta     = get<double>(p);
+        entry.um2px_r   = get<double>(p);
+        auto rows       = get<std::int32_t>(p);
+        auto cols       = get<std::int32_t>(p);
+        if(rows > 0 && cols > 0) {
+            entry.warp_mat.create(rows, cols);
+            for(int r = 0; r < rows; r ++) {
+                for(int c = 0; c < cols; c ++) {
+                    entry.warp_mat(r, c) = get<double>(p);
+                }
+            }
+        }
+        auto n = get<std::uint32_t>(p);
+        entry.markers.resize(n);
+        for(auto& mk : entry.markers) {
+            mk.x        = get<std::int32_t>(p);
+            mk.y        = get<std::int32_t>(p);
+            mk.width    = get<std::int32_t>(p);
+            mk.height   = get<std::int32_t>(p);
+            mk.x_i      = get<std::int32_t>(p);
+            mk.y_i      = get<std::int32_t>(p);
+            mk.score    = get<double>(p);
+        }
+        return entry;
+    }
+    /**
+     * @brief Map the file and index the complete records after valid_end_.
+     *        Requires the exclusive in-process lock.
+     */
+    void refresh() const {
+        auto file_size = boost::filesystem::file_size(path_);
+        if(file_size <= valid_end_) return;
+        boost::interprocess::file_mapping mapping(
+            path_.string().c_str(), boost::interprocess::read_only
+        );
+        auto region = std::make_shared<boost::interprocess::mapped_region>(
+            mapping, boost::interprocess::read_only, 0, file_size
+        );
+        // move the indexed records to the new mapping, so the old one is released
+        for(auto& [key, loc] : index_) {
+            loc.region = region;
+        }
+        auto* base = static_cast<const char*>(region->get_address());
+        std::size_t pos = valid_end_;
+        while(pos + record_head + sizeof(std::uint64_t) <= file_size) {
+            const char* p = base + pos;
+            auto magic  = get<std::uint32_t>(p);
+            auto size   = get<std::uint32_t>(p);
+            Key key;
+            key.image   = get<std::uint64_t>(p);
+            key.param   = get<std::uint64_t>(p);
+            auto end    = pos + record_head + size;
+            if(magic != record_magic || end + sizeof(std::uint64_t) > file_size) break;
+            std::uint64_t checksum;
+            std::memcpy(&checksum, base + end, sizeof(checksum));
+            if(checksum != hash_bytes(fnv_offset, base + pos, end - pos)) break;
+            index_[key] = Location{region, pos, size};
+            pos = end + sizeof(std::uint64_t);
+        }
+        valid_end_ = pos;
+    }
+
+    boost::filesystem::path                             path_       ;
+    boost::filesystem::path                             lock_path_  ;
+    boost::interprocess::file_lock                      file_lock_  ;
+    mutable std::shared_mutex                           mux_        ;
+    mutable std::unordered_map<Key, Location, KeyHash>  index_      ;
+    mutable std::size_t                                 valid_end_  {sizeof(file_magic)};
+};
+
+}}
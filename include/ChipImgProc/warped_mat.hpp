@@ -145,11 +145,62 @@ constexpr struct MakeWarpedMat {
             clwd, clhd
         );
     }
+    /**
+     * @brief Multi-channel version, the channels share the warp matrix and
+     *        the probe geometry. See chipimgproc::warped_mat::MakeStatMat.
+     *
+     * @return std::vector<WarpedMat<true, float>> One warped matrix per channel.
+     */
+    auto operator()(
+        cv::Mat                 warp_mat,
+        std::vector<cv::Mat>    channels,
+        // all micron level below
+        cv::Point2d origin,
+        int clw,         int clh,
+        int clwd,        int clhd,
+        int w,           int h,
+        double swin_w,   double swin_h,
+        double um2px_r,  double theor_max_val,
+        int clwn,        int clhn,
+        ViewerCallback v_margin
+    ) const {
+        auto tmp_timer(std::chrono::steady_clock::now());
+        std::chrono::duration<double, std::milli> d;
+        warped_mat::MakeStatMat<float> make_stat_mat;
+        auto [stat_mats, center_info] = make_stat_mat(
+            channels, origin,
+            clw,    clh,
+            clwd,   clhd,
+            w,      h,
+            swin_w, swin_h,
+            um2px_r,
+            theor_max_val,
+            clwn,   clhn,
+            warp_mat,
+            v_margin
+        );
+        d = std::chrono::steady_clock::now() - tmp_timer;
+        chipimgproc::log.info("ChipImgProc::MakeWarpedMat::operator()(...) - make_stat_mat ({} channels): {} ms", channels.size(), d.count());
+
+        std::vector<WarpedMat<true, float>> res;
+        res.reserve(channels.size());
+        for(std::size_t ch = 0; ch < channels.size(); ch ++) {
+            res.emplace_back(
+                warp_mat, channels[ch],
+                w, h,
+                std::move(stat_mats[ch]),
+                std::move(center_info[ch]),
+                origin,
+                clwd, clhd
+            );
+        }
+        return res;
+    }
     auto operator()(
         cv::Mat     warp_mat,
         cv::Mat     mat,
         // all micron level below
-        cv::Point2d origin, 
+        cv::Point2d origin,
         int clw,    int clh,
         int clwd,   int clhd,
         int w,      int h,
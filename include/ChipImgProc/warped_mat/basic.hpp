@@ -40,6 +40,13 @@ struct Basic
     , max_x_        (max_x)
     , max_y_        (max_y)
     {
+        cv::Mat_<double> warp;
+        warp_mat_.convertTo(warp, CV_64F);
+        for(int i = 0; i < 2; i ++) {
+            for(int j = 0; j < 3; j ++) {
+                warp_coef_[i * 3 + j] = warp(i, j);
+            }
+        }
         if(raw_images_.size() < 1) throw std::runtime_error("must provide at least 1 raw image");
         auto imsize = raw_images_[0].size();
         for(auto&& image : raw_images_) {
@@ -113,6 +120,63 @@ struct Basic
     ) const {
         return at_real(res, r, c, 0, patch_size);
     }
+    /**
+     * @brief Sample the patches of all raw images into the caller provided buffers.
+     * @details Unlike at_real_all, the result vector is resized to the number of 
+     *          raw images and each RawPatch::patch is reused as the output buffer 
+     *          of cv::getRectSubPix, so repeated calls with the same patch size do 
+     *          no heap allocation. The caller must not keep a reference to a patch 
+     *          buffer it wants to preserve, the next call overwrites it in place.
+     * 
+     * @param res           The reusable patch buffers, one per raw image.
+     * @param r             The row position in the real domain.
+     * @param c             The column position in the real domain.
+     * @param patch_size    The patch size in pixel.
+     * @return bool         false if the position is out of range.
+     */
+    bool sample_real_all(
+        std::vector<RawPatch>& res,
+        double r, 
+        double c, 
+        cv::Size patch_size = cv::Size(5, 5)
+    ) const {
+        if(!is_include_real_impl(r, c)) {
+            return false;
+        }
+        auto px_point = fast_point_transform(c, r);
+        if(!is_include_pixel_impl(px_point, patch_size)) {
+            return false;
+        }
+        res.resize(raw_images_.size());
+        for(std::size_t i = 0; i < raw_images_.size(); i ++) {
+            auto& patch = res[i];
+            cv::getRectSubPix(raw_images_[i], patch_size, px_point, patch.patch);
+            patch.img_p  = px_point;
+            patch.real_p = cv::Point2d(c, r);
+        }
+        return true;
+    }
+    /**
+     * @brief Sample the patch of the i-th raw image into the caller provided buffer.
+     *        See sample_real_all.
+     */
+    bool sample_real(
+        RawPatch& res,
+        double r, double c, int i, 
+        cv::Size patch_size = cv::Size(5, 5)
+    ) const {
+        if(!is_include_real_impl(r, c)) {
+            return false;
+        }
+        auto px_point = fast_point_transform(c, r);
+        if(!is_include_pixel_impl(px_point, patch_size)) {
+            return false;
+        }
+        cv::getRectSubPix(raw_images_.at(i), patch_size, px_point, res.patch);
+        res.img_p  = px_point;
+        res.real_p = cv::Point2d(c, r);
+        return true;
+    }
     const cv::Mat& warp_mat() const {
         return warp_mat_;
     }
@@ -149,16 +213,18 @@ private:
         return rect;                                                              // (*)  
     }                                                                             // (*)    
     std::tuple<cv::Point2d, cv::Point2d> point_transform(double x, double y) const {
-        std::vector<cv::Vec2d> src(1);
-        std::vector<cv::Vec2d> dst(1);
+        return nucleona::make_tuple(
+            cv::Point2d(x - 0.5, y - 0.5),
+            fast_point_transform(x, y)
+        );
+    }
+    // same as point_transform, the 2x3 affine transform is inlined
+    cv::Point2d fast_point_transform(double x, double y) const {
         x -= 0.5;
         y -= 0.5;
-        src[0][0] = x;
-        src[0][1] = y;
-        cv::transform(src, dst, warp_mat_);
-        return nucleona::make_tuple(
-            cv::Point2d(x, y),
-            cv::Point2d(dst.at(0)[0], dst.at(0)[1])
+        return cv::Point2d(
+            warp_coef_[0] * x + warp_coef_[1] * y + warp_coef_[2],
+            warp_coef_[3] * x + warp_coef_[4] * y + warp_coef_[5]
         );
     }
     static std::string point_out_of_boundary(double r, double c, const cv::Point2d& px) {
@@ -174,6 +240,7 @@ private:
         );
     }
     cv::Mat                 warp_mat_    ;
+    double                  warp_coef_[6];
     std::vector<cv::Mat>    raw_images_  ;
 protected:
     double                  max_x_       ;
@@ -0,0 +1,164 @@
+/**
+ * @file    compiled_mask.hpp
+ * @brief   @copybrief chipimgproc::warped_mat::CompiledMask
+ */
+#pragma once
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <mutex>
+#include <vector>
+#include <ChipImgProc/utils.h>
+#include <opencv2/gapi/core.hpp>
+#include <opencv2/gapi/imgproc.hpp>
+#include <opencv2/gapi/gpu/imgproc.hpp>
+#include <opencv2/gapi/cpu/core.hpp>
+#include <opencv2/gapi/cpu/imgproc.hpp>
+namespace chipimgproc::warped_mat {
+
+/**
+ * @brief The execution backend of the large mask generation.
+ */
+enum class MaskBackend {
+    gpu,    ///< G-API graph with the OpenCL (gpu) kernels, the default.
+    cpu,    ///< G-API graph with the OpenCV CPU kernels.
+    strip   ///< Native line-block pipeline, warp/filter/threshold run strip by strip
+            ///< so the intermediates stay in cache.
+};
+
+/**
+ * @brief The CompiledMask class keeps the compiled G-API graph of the
+ *        mask convolution chain (filter2D -> subC -> convertTo) across calls.
+ *
+ * @details The graph only depends on the image size, the convolution kernel
+ *          size and the filter output depth, so the compiled graph is cached
+ *          with this key and reused by every FOV which has the same geometry.
+ *          The warp matrix is a compile time constant of cv::gapi::warpAffine,
+ *          thus the warp step is not part of the cached graph.
+ *
+ *          A compiled graph can only be run by one caller at a time, so each
+ *          key keeps a pool of compiled instances. The lock is only held to
+ *          take an idle instance out of the pool and to put it back, the graph
+ *          is compiled and run outside of the lock. A caller finding no idle 
+ *          instance compiles a new one, so the pool grows to the number of 
+ *          concurrent callers.
+ *
+ *          The object is thread safe.
+ */
+struct CompiledMask {
+    using Key = std::tuple<int, int, int, int, int, MaskBackend>;
+
+    /**
+     * @brief Run the cached mask convolution on a warped mask.
+     *
+     * @param warped    The warped 8 bit mask, 255 for the probe area.
+     * @param out       The output 8 bit mask.
+     * @param ksize     The convolution kernel size in pixel.
+     * @param ddepth    The filter output depth.
+     * @param backend   The G-API kernel package, gpu or cpu.
+     */
+    void operator()(
+        const cv::Mat& warped, cv::Mat& out,
+        cv::Size ksize, int ddepth = CV_64F,
+        MaskBackend backend = MaskBackend::gpu
+    ) {
+        Key key(
+            warped.cols, warped.rows,
+            ksize.width, ksize.height,
+            ddepth, backend
+        );
+        auto compiled = acquire(key);
+        if(!compiled) {
+            compiled = compile(warped, ksize, ddepth, backend);
+        }
+        (*compiled)(cv::gin(warped), cv::gout(out));
+        release(key, std::move(compiled));
+    }
+    /**
+     * @brief Number of cached graph keys.
+     */
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(mux_);
+        return graphs_.size();
+    }
+    /**
+     * @brief Number of calls which reused an idle compiled graph.
+     */
+    std::size_t hits() const {
+        std::lock_guard<std::mutex> lock(mux_);
+        return hits_;
+    }
+    /**
+     * @brief Number of calls which compiled a new graph.
+     */
+    std::size_t misses() const {
+        std::lock_guard<std::mutex> lock(mux_);
+        return misses_;
+    }
+    /**
+     * @brief Drop all compiled graphs.
+     */
+    void clear() {
+        std::lock_guard<std::mutex> lock(mux_);
+        graphs_.clear();
+        hits_   = 0;
+        misses_ = 0;
+    }
+private:
+    using Compiled = std::unique_ptr<cv::GCompiled>;
+    Compiled acquire(const Key& key) {
+        std::lock_guard<std::mutex> lock(mux_);
+        auto& pool = graphs_[key];
+        if(pool.empty()) {
+            misses_ ++;
+            return nullptr;
+        }
+        auto compiled = std::move(pool.back());
+        pool.pop_back();
+        hits_ ++;
+        return compiled;
+    }
+    void release(const Key& key, Compiled compiled) {
+        std::lock_guard<std::mutex> lock(mux_);
+        auto itr = graphs_.find(key);
+        if(itr != graphs_.end()) {
+            itr->second.push_back(std::move(compiled));
+        }
+    }
+    static Compiled compile(
+        const cv::Mat& warped, cv::Size ksize, 
+        int ddepth, MaskBackend backend
+    ) {
+        auto computation = make_computation(ksize, ddepth);
+        if(backend == MaskBackend::gpu) {
+            return std::make_unique<cv::GCompiled>(computation.compile(
+                cv::descr_of(warped),
+                cv::compile_args(cv::gapi::imgproc::gpu::kernels())
+            ));
+        } else if(backend == MaskBackend::cpu) {
+            return std::make_unique<cv::GCompiled>(computation.compile(
+                cv::descr_of(warped),
+                cv::compile_args(cv::gapi::combine(
+                    cv::gapi::core::cpu::kernels(),
+                    cv::gapi::imgproc::cpu::kernels()
+                ))
+            ));
+        }
+        throw std::invalid_argument("CompiledMask: unsupported G-API backend");
+    }
+    static cv::GComputation make_computation(cv::Size ksize, int ddepth) {
+        cv::Mat kern = cv::Mat(ksize, CV_64F, cv::Scalar(1.0 / ksize.area()));
+        cv::GMat g_in;
+        cv::GMat g_tmp1 = cv::gapi::filter2D(g_in, ddepth, kern);
+        cv::GMat g_tmp2 = cv::gapi::subC(g_tmp1, cv::GScalar(254.49));
+        cv::GMat g_out  = cv::gapi::convertTo(g_tmp2, CV_8U);
+        return cv::GComputation(cv::GIn(g_in), cv::GOut(g_out));
+    }
+    mutable std::mutex                      mux_    ;
+    std::map<Key, std::vector<Compiled>>    graphs_ ;
+    std::size_t                             hits_   {0};
+    std::size_t                             misses_ {0};
+};
+
+}
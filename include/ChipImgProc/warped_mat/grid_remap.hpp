@@ -0,0 +1,213 @@
+/**
+ * @file    grid_remap.hpp
+ * @brief   @copybrief chipimgproc::warped_mat::GridRemap
+ */
+#pragma once
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <ChipImgProc/utils.h>
+namespace chipimgproc::warped_mat {
+
+/**
+ * @brief The GridRemap class rectifies the whole probe grid of a warped image
+ *        with a single cv::remap.
+ *
+ * @details The rectified image is a mosaic of probe patches, the probe at row r
+ *          and column c owns the tile cell_rect(r, c), whose pixels sample the
+ *          source image exactly at the positions warped_mat::Basic::at_cell uses
+ *          with cv::getRectSubPix (bilinear, replicated border). Per-probe patch
+ *          extraction then becomes a plain ROI view of the rectified image.
+ *
+ *          The remap maps only depend on the geometry, so one GridRemap object is
+ *          built once per FOV geometry and reused for every layer/channel.
+ *          The maps are stored in the fixed point format (CV_16SC2 + CV_16UC1),
+ *          so the interpolation weights are quantized to 1/32 pixel, which may
+ *          slightly differ from the float weights of cv::getRectSubPix.
+ */
+struct GridRemap {
+    GridRemap() = default;
+    /**
+     * @brief Build the remap maps of a probe grid.
+     *
+     * @param warpmat       The transformation matrix from the um domain to the pixel domain.
+     * @param origin        The origin of the probe grid in the um domain.
+     * @param clwd          The probe width (includes the gap) in the um domain.
+     * @param clhd          The probe height (includes the gap) in the um domain.
+     * @param clwn          Number of probes in a row.
+     * @param clhn          Number of probes in a column.
+     * @param patch_size    The probe patch size in pixel.
+     * @param dsize         The source image size.
+     */
+    GridRemap(
+        cv::Mat         warpmat,
+        cv::Point2d     origin,
+        double clwd,    double clhd,
+        int clwn,       int clhn,
+        cv::Size        patch_size,
+        cv::Size        dsize
+    )
+    : patch_size_   (patch_size)
+    , dsize_        (dsize)
+    , centers_      (clhn, clwn)
+    , valid_        (clhn, clwn)
+    {
+        warpmat.convertTo(warp_, CV_64F);
+        origin_ = origin;
+        clwd_   = clwd;
+        clhd_   = clhd;
+        auto pw = patch_size.width;
+        auto ph = patch_size.height;
+        map1_.create(clhn * ph, clwn * pw, CV_16SC2);
+        map2_.create(clhn * ph, clwn * pw, CV_16UC1);
+        cv::Mat_<float> map_x(ph, clwn * pw);
+        cv::Mat_<float> map_y(ph, clwn * pw);
+        for(int r = 0; r < clhn; r ++) {
+            for(int c = 0; c < clwn; c ++) {
+                // same as RegMatHelper::real_cell_cent and Basic::point_transform
+                auto x = (c * clwd) + origin.x + (clwd / 2) - 0.5;
+                auto y = (r * clhd) + origin.y + (clhd / 2) - 0.5;
+                cv::Point2d px(
+                    warp_(0, 0) * x + warp_(0, 1) * y + warp_(0, 2),
+                    warp_(1, 0) * x + warp_(1, 1) * y + warp_(1, 2)
+                );
+                centers_(r, c) = px;
+                valid_(r, c) = is_include_pixel(px);
+                // same sample positions as cv::getRectSubPix
+                auto x0 = px.x - (pw - 1) * 0.5;
+                auto y0 = px.y - (ph - 1) * 0.5;
+                for(int v = 0; v < ph; v ++) {
+                    auto* mx = map_x.ptr<float>(v) + c * pw;
+                    auto* my = map_y.ptr<float>(v) + c * pw;
+                    for(int u = 0; u < pw; u ++) {
+                        mx[u] = x0 + u;
+                        my[u] = y0 + v;
+                    }
+                }
+            }
+            // convert row by row, the float maps never exist at full size
+            cv::Mat map1_rows = map1_.rowRange(r * ph, (r + 1) * ph);
+            cv::Mat map2_rows = map2_.rowRange(r * ph, (r + 1) * ph);
+            cv::convertMaps(map_x, map_y, map1_rows, map2_rows, CV_16SC2);
+        }
+    }
+    /**
+     * @brief Rectify an image of the same size as the source image.
+     *
+     * @param src   The source image, any layer/channel of the FOV.
+     * @return cv::Mat The rectified probe mosaic.
+     */
+    cv::Mat operator()(const cv::Mat& src) const {
+        if(src.size() != dsize_) {
+            throw std::invalid_argument("GridRemap: image size mismatch");
+        }
+        cv::Mat res;
+        cv::remap(src, res, map1_, map2_, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+        return res;
+    }
+    /**
+     * @brief The tile of probe (r, c) in the rectified image.
+     */
+    cv::Rect cell_rect(int r, int c) const {
+        return cv::Rect(
+            c * patch_size_.width, r * patch_size_.height,
+            patch_size_.width, patch_size_.height
+        );
+    }
+    /**
+     * @brief The subpixel center of probe (r, c) in the source image.
+     */
+    cv::Point2d cell_center(int r, int c) const {
+        return centers_(r, c);
+    }
+    /**
+     * @brief The real (um) domain center of probe (r, c).
+     */
+    cv::Point2d cell_real_center(int r, int c) const {
+        return cv::Point2d(
+            (c * clwd_) + origin_.x + (clwd_ / 2),
+            (r * clhd_) + origin_.y + (clhd_ / 2)
+        );
+    }
+    /**
+     * @brief Same boundary rule as Basic::at_cell_all, false if the patch of
+     *        probe (r, c) is too close to the image border.
+     */
+    bool valid(int r, int c) const {
+        return valid_(r, c);
+    }
+    /**
+     * @brief Check if the maps were built from the given geometry.
+     */
+    bool is_same_geometry(
+        const cv::Mat&  warpmat,
+        cv::Point2d     origin,
+        double clwd,    double clhd,
+        int clwn,       int clhn,
+        cv::Size        patch_size,
+        cv::Size        dsize
+    ) const {
+        if(warp_.empty()) return false;
+        cv::Mat_<double> warp;
+        warpmat.convertTo(warp, CV_64F);
+        return cv::countNonZero(warp != warp_) == 0
+            && origin       == origin_
+            && clwd         == clwd_
+            && clhd         == clhd_
+            && clwn         == centers_.cols
+            && clhn         == centers_.rows
+            && patch_size   == patch_size_
+            && dsize        == dsize_
+        ;
+    }
+private:
+    bool is_include_pixel(cv::Point2d px) const {
+        auto safe_padding_x = patch_size_.width * 2;
+        auto safe_padding_y = patch_size_.height * 2;
+        if(px.x < safe_padding_x) return false;
+        if(px.y < safe_padding_y) return false;
+        if(px.x >= (dsize_.width  - safe_padding_x)) return false;
+        if(px.y >= (dsize_.height - safe_padding_y)) return false;
+        return true;
+    }
+    cv::Mat_<double>        warp_       ;
+    cv::Point2d             origin_     ;
+    double                  clwd_       {0};
+    double                  clhd_       {0};
+    cv::Size                patch_size_ ;
+    cv::Size                dsize_      ;
+    cv::Mat_<cv::Point2d>   centers_    ;
+    cv::Mat_<std::uint8_t>  valid_      ;
+    cv::Mat                 map1_       ;
+    cv::Mat                 map2_       ;
+};
+
+/**
+ * @brief Keep the GridRemap of the last geometry, so repeated layers/channels
+ *        of the same FOV only pay the remap. Thread safe.
+ */
+struct GridRemapCache {
+    std::shared_ptr<const GridRemap> get(
+        const cv::Mat&  warpmat,
+        cv::Point2d     origin,
+        double clwd,    double clhd,
+        int clwn,       int clhn,
+        cv::Size        patch_size,
+        cv::Size        dsize
+    ) {
+        std::lock_guard<std::mutex> lock(mux_);
+        if(!remap_ || !remap_->is_same_geometry(
+            warpmat, origin, clwd, clhd, clwn, clhn, patch_size, dsize
+        )) {
+            remap_ = std::make_shared<const GridRemap>(
+                warpmat, origin, clwd, clhd, clwn, clhn, patch_size, dsize
+            );
+        }
+        return remap_;
+    }
+private:
+    std::shared_ptr<const GridRemap>    remap_  ;
+    std::mutex                          mux_    ;
+};
+
+}
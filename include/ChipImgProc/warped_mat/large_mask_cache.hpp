@@ -0,0 +1,213 @@
+/**
+ * @file    large_mask_cache.hpp
+ * @brief   @copybrief chipimgproc::warped_mat::LargeMaskCache
+ */
+#pragma once
+#include <cfloat>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <ChipImgProc/utils.h>
+namespace chipimgproc::warped_mat {
+
+/**
+ * @brief The LargeMaskCache class reuses the large warped mask and the probe
+ *        label image across FOVs with the same warp geometry.
+ *
+ * @details FOVs of the same chip usually share the probe pitch, the um to pixel
+ *          rate and almost the same warp matrix, only the translation changes.
+ *          When the linear part of the warp matrix is the same and the translation
+ *          differs by an integer pixel offset, the cached products are shifted by
+ *          this offset instead of re-rasterizing the mask and re-labelling it.
+ *
+ *          The tolerance is the maximum position error in pixel allowed at the
+ *          corners of the probe grid, which comes from the difference of the
+ *          linear part and the fractional part of the translation difference.
+ *
+ *          A shifted mask is only exact when no probe is clipped or touched by
+ *          the filter border, both in the cached FOV and in the current one. So
+ *          a hit also requires the pixel bounding box of the probe grid to stay
+ *          at least the given border away from the image edges before and after
+ *          the shift, otherwise the mask is rebuilt.
+ *
+ *          The object is thread safe and can be shared by parallel FOV workers.
+ */
+struct LargeMaskCache {
+    /**
+     * @brief Create an empty cache.
+     *
+     * @param tolerance     Maximum position error (pixel) of a cache hit.
+     * @param capacity      Maximum number of cached geometries, the oldest one
+     *                      is dropped first.
+     */
+    LargeMaskCache(double tolerance = 0.01, std::size_t capacity = 4)
+    : tolerance_    (tolerance)
+    , capacity_     (std::max<std::size_t>(capacity, 1))
+    {}
+
+    /**
+     * @brief Find the products of a geometry.
+     *
+     * @param geom          All the scalar mask parameters except the warp matrix,
+     *                      compared exactly.
+     * @param warpmat       The warp matrix of the current FOV.
+     * @param extent        The um domain extent (w, h) of the probe grid.
+     * @param need_label    true if the label image is required.
+     * @param border        The minimum distance (pixel) between the mask and the
+     *                      image edges, at least the mask convolution kernel size.
+     * @param lmask         Output, the shifted large mask.
+     * @param label         Output, the shifted label image, empty if not cached.
+     * @return bool         true if hit.
+     */
+    bool find(
+        const std::vector<double>&  geom,
+        const cv::Mat&              warpmat,
+        cv::Size2d                  extent,
+        bool                        need_label,
+        cv::Size                    border,
+        cv::Mat&                    lmask,
+        cv::Mat&                    label
+    ) {
+        cv::Mat_<double> warp;
+        warpmat.convertTo(warp, CV_64F);
+        std::lock_guard<std::mutex> lock(mux_);
+        for(auto&& entry : entries_) {
+            if(entry.geom != geom) continue;
+            if(need_label && entry.label.empty()) continue;
+            cv::Point shift;
+            if(!match(entry.warp, warp, extent, shift)) continue;
+            if(!inside(entry.warp, extent, shift, entry.lmask.size(), border)) continue;
+            lmask = shift_mat(entry.lmask, shift);
+            label = entry.label.empty() ? cv::Mat() : shift_mat(entry.label, shift);
+            hits_ ++;
+            return true;
+        }
+        misses_ ++;
+        return false;
+    }
+    /**
+     * @brief Store the products of a geometry.
+     */
+    void insert(
+        const std::vector<double>&  geom,
+        const cv::Mat&              warpmat,
+        const cv::Mat&              lmask,
+        const cv::Mat&              label
+    ) {
+        Entry entry;
+        entry.geom  = geom;
+        warpmat.convertTo(entry.warp, CV_64F);
+        entry.lmask = lmask.clone();
+        entry.label = label.clone();
+        std::lock_guard<std::mutex> lock(mux_);
+        for(auto itr = entries_.begin(); itr != entries_.end(); ++ itr) {
+            if(itr->geom == geom) {
+                entries_.erase(itr);
+                break;
+            }
+        }
+        if(entries_.size() >= capacity_) {
+            entries_.pop_front();
+        }
+        entries_.push_back(std::move(entry));
+    }
+    std::size_t hits() const {
+        std::lock_guard<std::mutex> lock(mux_);
+        return hits_;
+    }
+    std::size_t misses() const {
+        std::lock_guard<std::mutex> lock(mux_);
+        return misses_;
+    }
+    double tolerance() const {
+        return tolerance_;
+    }
+    void clear() {
+        std::lock_guard<std::mutex> lock(mux_);
+        entries_.clear();
+        hits_   = 0;
+        misses_ = 0;
+    }
+private:
+    struct Entry {
+        std::vector<double> geom    ;
+        cv::Mat_<double>    warp    ;
+        cv::Mat             lmask   ;
+        cv::Mat             label   ;
+    };
+    bool match(
+        const cv::Mat_<double>& cached,
+        const cv::Mat_<double>& curr,
+        cv::Size2d              extent,
+        cv::Point&              shift
+    ) const {
+        auto tx = curr(0, 2) - cached(0, 2);
+        auto ty = curr(1, 2) - cached(1, 2);
+        shift.x = std::round(tx);
+        shift.y = std::round(ty);
+        const cv::Point2d corners[] = {
+            {0, 0}, {extent.width, 0},
+            {0, extent.height}, {extent.width, extent.height}
+        };
+        for(auto&& p : corners) {
+            auto ex = (curr(0, 0) - cached(0, 0)) * p.x
+                    + (curr(0, 1) - cached(0, 1)) * p.y
+                    + tx - shift.x;
+            auto ey = (curr(1, 0) - cached(1, 0)) * p.x
+                    + (curr(1, 1) - cached(1, 1)) * p.y
+                    + ty - shift.y;
+            if(std::sqrt(ex * ex + ey * ey) > tolerance_) return false;
+        }
+        return true;
+    }
+    static bool inside(
+        const cv::Mat_<double>& warp,
+        cv::Size2d              extent,
+        cv::Point               shift,
+        cv::Size                size,
+        cv::Size                border
+    ) {
+        double x0 = DBL_MAX, y0 = DBL_MAX, x1 = -DBL_MAX, y1 = -DBL_MAX;
+        const cv::Point2d corners[] = {
+            {0, 0}, {extent.width, 0},
+            {0, extent.height}, {extent.width, extent.height}
+        };
+        for(auto&& p : corners) {
+            auto x = warp(0, 0) * p.x + warp(0, 1) * p.y + warp(0, 2);
+            auto y = warp(1, 0) * p.x + warp(1, 1) * p.y + warp(1, 2);
+            x0 = std::min(x0, x); x1 = std::max(x1, x);
+            y0 = std::min(y0, y); y1 = std::max(y1, y);
+        }
+        cv::Rect grid(
+            std::floor(x0), std::floor(y0),
+            std::ceil(x1) - std::floor(x0) + 1,
+            std::ceil(y1) - std::floor(y0) + 1
+        );
+        cv::Rect inner(
+            border.width, border.height,
+            size.width  - 2 * border.width,
+            size.height - 2 * border.height
+        );
+        if(inner.width <= 0 || inner.height <= 0) return false;
+        auto shifted = grid + shift;
+        return (grid & inner) == grid && (shifted & inner) == shifted;
+    }
+    static cv::Mat shift_mat(const cv::Mat& src, cv::Point shift) {
+        cv::Mat dst = cv::Mat::zeros(src.size(), src.type());
+        cv::Rect src_rect(0, 0, src.cols, src.rows);
+        cv::Rect dst_rect = (src_rect + shift) & src_rect;
+        if(dst_rect.area() > 0) {
+            src(dst_rect - shift).copyTo(dst(dst_rect));
+        }
+        return dst;
+    }
+    double                  tolerance_  ;
+    std::size_t             capacity_   ;
+    std::deque<Entry>       entries_    ;
+    std::size_t             hits_       {0};
+    std::size_t             misses_     {0};
+    mutable std::mutex      mux_        ;
+};
+
+}
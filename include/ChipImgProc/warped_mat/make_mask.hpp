@@ -1,13 +1,15 @@
 #pragma once
+#include <memory>
 #include <ChipImgProc/utils.h>
-#include <opencv2/gapi/core.hpp>
-#include <opencv2/gapi/imgproc.hpp>
-#include <opencv2/gapi/gpu/imgproc.hpp>
+#include "compiled_mask.hpp"
 namespace chipimgproc::warped_mat {
 
 struct MakeMask {
+    MakeMask()
+    : compiled_mask_(std::make_shared<CompiledMask>())
+    {}
     cv::Mat operator()(
-        cv::Point origin, 
+        cv::Point origin,
         int clw,       int clh,
         int clwd,      int clhd,
         int w,         int h,
@@ -19,53 +21,146 @@ struct MakeMask {
     ) const {
         auto tmp_timer(std::chrono::steady_clock::now());
         std::chrono::duration<double, std::milli> d, d1;
-        
+
         auto roiw = clwd * clwn;
         auto roih = clhd * clhn;
         int clwsp = (clwd - clw) / 2;
         int clhsp = (clhd - clh) / 2;
         int conv_w_px = std::round(conv_w * um2px_r);
         int conv_h_px = std::round(conv_h * um2px_r);
+        cv::Size ksize(conv_w_px, conv_h_px);
         cv::Mat res = cv::Mat::zeros(dsize, CV_8U);
-        cv::Mat kern = cv::Mat(conv_h_px, conv_w_px, CV_64F, cv::Scalar(1.0 / (conv_h_px * conv_w_px)));
-        cv::GMat g_in;
-        cv::GMat g_tmp1 = cv::gapi::warpAffine(g_in, warpmat, dsize);
-        cv::GMat g_tmp2 = cv::gapi::filter2D(g_tmp1, CV_64F, kern);
-        cv::GMat g_tmp3 = cv::gapi::subC(g_tmp2, cv::GScalar(254.49));
-        cv::GMat g_out  = cv::gapi::convertTo(g_tmp3, CV_8U);
-        cv::GComputation computation(cv::GIn(g_in), cv::GOut(g_out));
-        
+        auto warp_conv = [&, this](const cv::Mat& mat) {
+            cv::Mat warp_mask(dsize, CV_8U);
+            if(backend_ == MaskBackend::strip) {
+                strip_warp_conv(mat, warp_mask, warpmat, ksize);
+            } else {
+                cv::Mat warped;
+                cv::warpAffine(mat, warped, warpmat, dsize);
+                (*compiled_mask_)(warped, warp_mask, ksize, CV_64F, backend_);
+            }
+            return warp_mask;
+        };
+
         // d1 = std::chrono::steady_clock::now() - tmp_timer;
         // std::cout << "make_mask-init: " << d1.count() << " ms\n";
-        for(int i = 0; i < 2; i ++) {
-            for(int j = 0; j < 2; j ++) {
-                cv::Mat mat = cv::Mat::zeros(h, w, CV_8U);
-                cv::Point org_off(
-                    origin.x + clwd * j,
-                    origin.y + clhd * i
+        if(fuse_partial_mask_ && is_fusible(clw, clh, clwd, clhd, um2px_r)) {
+            cv::Mat mat = cv::Mat::zeros(h, w, CV_8U);
+            {
+                cv::Rect mat_rect(0, 0, mat.cols, mat.rows);
+                auto tmp = mat(cv::Rect(origin.x, origin.y, roiw, roih) & mat_rect);
+                partial_mask(
+                    clw, clh, clwd, clhd, clwsp, clhsp, 255, tmp
                 );
-                {
-                    cv::Rect mat_rect(0, 0, mat.cols, mat.rows);
-                    auto tmp = mat(cv::Rect(org_off.x, org_off.y, roiw, roih) & mat_rect);
-                    partial_mask(
-                        clw, clh, clwd * 2, clhd * 2, clwsp, clhsp, 255, tmp
+            }
+            res = warp_conv(mat);
+        } else {
+            for(int i = 0; i < 2; i ++) {
+                for(int j = 0; j < 2; j ++) {
+                    cv::Mat mat = cv::Mat::zeros(h, w, CV_8U);
+                    cv::Point org_off(
+                        origin.x + clwd * j,
+                        origin.y + clhd * i
                     );
+                    {
+                        cv::Rect mat_rect(0, 0, mat.cols, mat.rows);
+                        auto tmp = mat(cv::Rect(org_off.x, org_off.y, roiw, roih) & mat_rect);
+                        partial_mask(
+                            clw, clh, clwd * 2, clhd * 2, clwsp, clhsp, 255, tmp
+                        );
+                    }
+                    res += warp_conv(mat);
                 }
-                cv::Mat warp_mask(dsize, CV_8U);
-                computation.apply(
-                    cv::gin(mat), 
-                    cv::gout(warp_mask), 
-                    cv::compile_args(cv::gapi::imgproc::gpu::kernels())
-                );
-                res += warp_mask;
             }
         }
 		d = std::chrono::steady_clock::now() - tmp_timer;
         chipimgproc::log.info("chipimgproc::warped_mat::MakeMask::operator()(...) - make_mask: {} ms", d.count());
 
         return res >= 1;
-    } 
+    }
+    /**
+     * @brief Enable/disable the fused partial mask mode.
+     * @details By default the probes are split into 4 interleaved partial masks
+     *          and each partial mask is warped and convolved separately, so the
+     *          convolution never mixes two adjacent probes. When the gap between
+     *          two probes is at least one pixel after the um to pixel scaling,
+     *          the gap itself separates the probes and the 4 passes can be fused
+     *          into one. If the gap is too small, the 4 passes are still used.
+     *
+     * @param enable true to fuse the partial masks, by default it is disabled.
+     */
+    void set_fuse_partial_mask(bool enable) {
+        fuse_partial_mask_ = enable;
+    }
+    /**
+     * @brief Select the execution backend of the mask generation.
+     * @details The gpu and cpu backends run the cached G-API graph on the full 
+     *          size warped mask. The strip backend is meant for CPU only nodes, 
+     *          it warps, filters and thresholds the mask in horizontal strips of 
+     *          strip_rows rows (plus the filter halo), so the CV_64F filter 
+     *          intermediate is strip sized and stays in cache instead of being 
+     *          streamed through memory at full FOV size.
+     * 
+     * @param backend       The execution backend, by default MaskBackend::gpu.
+     * @param strip_rows    The output rows of a strip, only used by the strip backend.
+     */
+    void set_backend(MaskBackend backend, int strip_rows = 64) {
+        backend_    = backend;
+        strip_rows_ = std::max(strip_rows, 1);
+    }
+    MaskBackend backend() const {
+        return backend_;
+    }
+    /**
+     * @brief The compiled graph cache shared by the copies of this object.
+     */
+    const std::shared_ptr<CompiledMask>& compiled_mask() const {
+        return compiled_mask_;
+    }
 private:
+    bool is_fusible(
+        int clw,  int clh,
+        int clwd, int clhd,
+        double um2px_r
+    ) const {
+        return (clwd - clw) * um2px_r >= 1.0
+            && (clhd - clh) * um2px_r >= 1.0;
+    }
+    void strip_warp_conv(
+        const cv::Mat& mat, cv::Mat& out,
+        const cv::Mat& warpmat, cv::Size ksize
+    ) const {
+        cv::Mat_<double> inv_warp;
+        {
+            cv::Mat_<double> fwd;
+            warpmat.convertTo(fwd, CV_64F);
+            cv::invertAffineTransform(fwd, inv_warp);
+        }
+        cv::Mat kern(ksize, CV_64F, cv::Scalar(1.0 / ksize.area()));
+        // same anchor as filter2D, halo rows above and below a strip
+        int halo_top    = ksize.height / 2;
+        int halo_bottom = ksize.height - 1 - halo_top;
+        cv::Mat warped;
+        cv::Mat filtered;
+        for(int y0 = 0; y0 < out.rows; y0 += strip_rows_) {
+            int y1 = std::min(out.rows, y0 + strip_rows_);
+            int ys = std::max(0, y0 - halo_top);
+            int ye = std::min(out.rows, y1 + halo_bottom);
+            // the strip is a translated destination of the full warp
+            cv::Mat_<double> strip_warp = inv_warp.clone();
+            strip_warp(0, 2) += inv_warp(0, 1) * ys;
+            strip_warp(1, 2) += inv_warp(1, 1) * ys;
+            cv::warpAffine(
+                mat, warped, strip_warp, cv::Size(out.cols, ye - ys),
+                cv::INTER_LINEAR | cv::WARP_INVERSE_MAP
+            );
+            // strip borders are either inner rows (full halo) or image borders
+            cv::filter2D(warped, filtered, CV_64F, kern);
+            filtered.rowRange(y0 - ys, y1 - ys).convertTo(
+                out.rowRange(y0, y1), CV_8U, 1.0, -254.49
+            );
+        }
+    }
     void partial_mask(
         int clw,  int clh,
         int clwd, int clhd,
@@ -80,6 +175,10 @@ private:
             }
         }
     }
+    std::shared_ptr<CompiledMask>   compiled_mask_      ;
+    bool                            fuse_partial_mask_  {false};
+    MaskBackend                     backend_            {MaskBackend::gpu};
+    int                             strip_rows_         {64};
 };
 
 
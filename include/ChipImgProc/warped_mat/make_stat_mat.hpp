@@ -9,8 +9,12 @@
 #include <Nucleona/tuple.hpp>
 #include "make_mask.hpp"
 #include "basic.hpp"
+#include "probe_label.hpp"
+#include "large_mask_cache.hpp"
+#include "grid_remap.hpp"
 #include <ChipImgProc/stat/mats.hpp>
 #include <ChipImgProc/obj_mat.hpp>
+#include <ChipImgProc/algo/block_parallel.hpp>
 #include <opencv2/gapi/core.hpp>
 #include <opencv2/gapi/imgproc.hpp>
 #include <opencv2/gapi/gpu/imgproc.hpp>
@@ -114,6 +118,53 @@ struct MakeStatMat {
         ViewerCallback  v_comp   = {},
         ViewerCallback  v_mask   = {}
     ) const {
+        auto [stat_mats, cell_info] = operator()(
+            std::vector<cv::Mat>{mat}, origin,
+            clw, clh, clwd, clhd, w, h,
+            swin_w, swin_h, um2px_r, theor_max_val,
+            clwn, clhn, warpmat,
+            v_margin, v_comp, v_mask
+        );
+        return nucleona::make_tuple(
+            std::move(stat_mats.at(0)), 
+            std::move(cell_info.at(0))
+        );
+    }
+    /**
+     * @brief       Compute the representative intensity for each probe of several channel images.
+     * @details     The channel images are taken at the same stage position (e.g. several 
+     *              fluorescence channels of one FOV), so they share the warp matrix. The large 
+     *              warped mask, the probe labels and the probe sample positions are computed 
+     *              once and every channel is extracted in the same pass over the probes. 
+     *              The result of each channel is the same as calling the single channel 
+     *              version on it.
+     * 
+     * @param channels           Input fluorescent images, one per channel, all with the same size.
+     * @param v_margin           Debug viewer, called once per channel.
+     * 
+     * Other parameters are the same as the single channel version.
+     * 
+     * @return auto A tuple of std::vector<stat::Mats<Float>> and std::vector<ObjMat<RawPatch, std::int32_t>>, 
+     *              one element per channel.
+     */
+    auto operator()(
+        std::vector<cv::Mat> channels,
+        cv::Point2d     origin, 
+        int clw,        int clh,
+        int clwd,       int clhd,
+        int w,          int h,
+        double swin_w,  double swin_h,
+        double          um2px_r,
+        double          theor_max_val,
+        int clwn,       int clhn,
+        cv::Mat         warpmat,
+        ViewerCallback  v_margin = {},
+        ViewerCallback  v_comp   = {},
+        ViewerCallback  v_mask   = {}
+    ) const {
+        if(channels.empty()) throw std::invalid_argument("MakeStatMat: must provide at least 1 channel image");
+        const auto chn = channels.size();
+        const auto dsize = channels.front().size();
         
         /* Prepare parameters for the downstream analysis (the large waped mask generation and the probe intensity extraction) */
         int swin_w_px = std::round(swin_w * um2px_r);
@@ -124,27 +175,65 @@ struct MakeStatMat {
         // auto tmp_timer(std::chrono::steady_clock::now());
         // std::chrono::duration<double, std::milli> d, d1;
 
-        /* Generate the large waped mask to identify the pure probe convolution region of each probe. */
+        /* Generate the large waped mask to identify the pure probe convolution region of each probe. 
+           When the large mask cache is set and a previous FOV has the same geometry up to an 
+           integer translation, the cached mask and labels are shifted instead. */
         // tmp_timer = std::chrono::steady_clock::now();
-        auto lmask = make_large_mask(
-            {
-                static_cast<int>(std::round(origin.x)), 
-                static_cast<int>(std::round(origin.y))
-            },
-            clw, clh, clwd, clhd,
-            w, h, swin_w, swin_h, um2px_r, 
-            clwn, clhn, warpmat, mat.size()
+        cv::Point mask_origin(
+            static_cast<int>(std::round(origin.x)), 
+            static_cast<int>(std::round(origin.y))
         );
+        std::vector<double> mask_geom({
+            static_cast<double>(mask_origin.x), static_cast<double>(mask_origin.y),
+            static_cast<double>(clw), static_cast<double>(clh), 
+            static_cast<double>(clwd), static_cast<double>(clhd),
+            static_cast<double>(w), static_cast<double>(h), 
+            swin_w, swin_h, um2px_r,
+            static_cast<double>(clwn), static_cast<double>(clhn),
+            static_cast<double>(dsize.width), static_cast<double>(dsize.height)
+        });
+        cv::Mat lmask;
+        cv::Mat_<std::int32_t> mask_cell_label;
+        bool mask_cache_hit = false;
+        if(large_mask_cache_) {
+            cv::Mat cached_label;
+            // the probes within a kernel size from the edges are touched by the filter border
+            mask_cache_hit = large_mask_cache_->find(
+                mask_geom, warpmat, cv::Size2d(w, h), !analytic_label_,
+                cv::Size(swin_w_px + 1, swin_h_px + 1), lmask, cached_label
+            );
+            if(mask_cache_hit && !analytic_label_) {
+                mask_cell_label = cached_label;
+            }
+        }
+        if(!mask_cache_hit) {
+            lmask = make_large_mask(
+                mask_origin,
+                clw, clh, clwd, clhd,
+                w, h, swin_w, swin_h, um2px_r, 
+                clwn, clhn, warpmat, dsize
+            );
+        }
         // cv::Mat test_img;
         // lmask.convertTo(test_img, CV_16U);
         // cv::imwrite("large_mask.tiff", test_img);
         // d = std::chrono::steady_clock::now() - tmp_timer;
         // chipimgproc::log.info("chipimgproc::warped_mat::MakeStatMat::operator()(...) - make_large_mask: {} ms", d.count());
 
-        /* Label the pure probe convolution region of each probe with the natrual number. */
+        /* Label the pure probe convolution region of each probe with the natrual number. 
+           In the analytic label mode the label of each pixel is computed on demand from 
+           the probe grid, so the full image labelling pass is skipped. */
         // tmp_timer = std::chrono::steady_clock::now();
-        cv::Mat_<std::int32_t> mask_cell_label(lmask.size());
-        cv::connectedComponents(lmask, mask_cell_label);
+        ProbeLabel probe_label(warpmat, origin, clwd, clhd, clwn, clhn);
+        if(!mask_cache_hit) {
+            if(!analytic_label_) {
+                mask_cell_label.create(lmask.size());
+                cv::connectedComponents(lmask, mask_cell_label);
+            }
+            if(large_mask_cache_) {
+                large_mask_cache_->insert(mask_geom, warpmat, lmask, mask_cell_label);
+            }
+        }
         // d = std::chrono::steady_clock::now() - tmp_timer;
         // std::cout << "connectedComponents: " << d.count() << " ms\n";
         
@@ -152,10 +241,14 @@ struct MakeStatMat {
            related debug images. */
         // tmp_timer = std::chrono::steady_clock::now();
         {
-            cv::Mat comp_img;
-            mask_cell_label.convertTo(comp_img, CV_16U);
-            // cv::imwrite("mask_label.tiff", comp_img);
             if(v_comp) {
+                cv::Mat comp_img;
+                if(analytic_label_) {
+                    probe_label.label_image(lmask).convertTo(comp_img, CV_16U);
+                } else {
+                    mask_cell_label.convertTo(comp_img, CV_16U);
+                }
+                // cv::imwrite("mask_label.tiff", comp_img);
                 v_comp(comp_img);
             }
             if(v_mask) {
@@ -167,121 +260,388 @@ struct MakeStatMat {
 
         /* Stack up all the useful information above and creates containers (stat_mats, 
            cell_info) for storing the computed information of each probe. */
-        ip_convert(mask_cell_label, CV_32F);
-        cv::Mat mat_clone;
-        mat.convertTo(mat_clone, CV_16U);
+        std::vector<cv::Mat> agg_layers;
+        if(!analytic_label_) {
+            ip_convert(mask_cell_label, CV_32F);
+            agg_layers.push_back(mask_cell_label);
+        }
+        agg_layers.push_back(lmask);
+        for(auto&& mat : channels) {
+            agg_layers.push_back(mat);
+        }
+        if(whole_fov_stat_) {
+            /* Compute the windowed statistics maps once for the whole FOV, the probes 
+               then only sample these maps. */
+            for(auto&& mat : channels) {
+                auto [fov_mean, fov_var, fov_cv_2] = make_fov_stats(mat, theor_max_val, swin_w_px, swin_h_px);
+                agg_layers.push_back(fov_mean);
+                agg_layers.push_back(fov_var);
+                agg_layers.push_back(fov_cv_2);
+            }
+        }
         auto warped_agg_mat = make_basic(warpmat, 
-            std::vector<cv::Mat>({
-                mask_cell_label,
-                lmask,
-                mat
-            }),
+            agg_layers,
             origin, clwd, clhd, w, h
         );
-        ObjMat<RawPatch, std::int32_t> cell_info(clhn, clwn);
-        stat::Mats<Float> stat_mats(clhn, clwn);
-        auto cell = warped_agg_mat.make_at_result();
-        std::vector<decltype(cell)> mats;
+        /* In the grid remap mode every layer is rectified once with a single remap, 
+           the probe patches are then ROI views of the rectified layers. */
+        std::shared_ptr<const GridRemap> grid_remap;
+        std::vector<cv::Mat> rectified;
+        if(grid_remap_cache_) {
+            grid_remap = grid_remap_cache_->get(
+                warpmat, origin, clwd, clhd, clwn, clhn, 
+                cv::Size(clw_px, clh_px), dsize
+            );
+            for(auto&& layer : agg_layers) {
+                rectified.push_back((*grid_remap)(layer));
+            }
+        }
+        std::vector<ObjMat<RawPatch, std::int32_t>> cell_info;
+        std::vector<stat::Mats<Float>> stat_mats;
+        for(std::size_t ch = 0; ch < chn; ch ++) {
+            cell_info.emplace_back(clhn, clwn);
+            stat_mats.emplace_back(clhn, clwn);
+        }
+        /* In the slab storage mode the raw patches of a channel are tiles of one 
+           buffer, probe (i, j) owns the tile at (j * clw_px, i * clh_px). The 
+           rectified raw layers of the grid remap mode already have this layout. */
+        std::vector<cv::Mat> patch_slabs;
+        if(patch_storage_ == PatchStorage::slab) {
+            const int raw_i0 = analytic_label_ ? 1 : 2;
+            for(std::size_t ch = 0; ch < chn; ch ++) {
+                if(grid_remap) {
+                    patch_slabs.push_back(rectified.at(raw_i0 + ch));
+                } else {
+                    patch_slabs.emplace_back(
+                        clhn * clh_px, clwn * clw_px, channels[ch].type()
+                    );
+                }
+            }
+        }
 		// d = std::chrono::steady_clock::now() - tmp_timer;
         // std::cout << "init stat_mat: " << d.count() << " ms\n";
         
 		// tmp_timer = std::chrono::steady_clock::now();
 
-        /* Compute and extract the desired inforamtion for each probe. */
-        for(int i = 0; i < clhn; i ++) {
-            for(int j = 0; j < clwn; j ++) {
-                /* Get the label ID from the corresponding large warped mask and compute the 
-                   subpixel-level information (positions (cent_img, cent_rum), pure probe 
-                   convolution region (sub_lab, sub_mask), ROI raw image (sub_raw)) for that 
-                   probe. */
-                if(!warped_agg_mat.at_cell(
-                    cell, i, j, cv::Size(1, 1)
-                )) {
-                    throw std::out_of_range(
-                        fmt::format("invalid cell index ({},{})", i, j)
-                    );
-                }
-                if(!warped_agg_mat.at_cell_all(
-                    mats, i, j, cv::Size(clw_px, clh_px)
-                )) {
-                    throw std::out_of_range(
-                        fmt::format("invalid cell index ({},{})", i, j)
+        /* Compute and extract the desired inforamtion for each probe. The probe rows 
+           are split into blocks, each block owns its scratch buffers and writes only 
+           its own rows of stat_mats and cell_info, so no locking is needed and the 
+           result is identical to the serial row-major loop. */
+        algo::block_parallel(clhn, thread_num_, [&](int blk, int beg, int end) {
+            auto cell = warped_agg_mat.make_at_result();
+            std::vector<decltype(cell)> mats;
+            for(int i = beg; i < end; i ++) {
+                for(int j = 0; j < clwn; j ++) {
+                    extract_cell(
+                        warped_agg_mat, probe_label, grid_remap.get(), rectified,
+                        cell, mats, i, j,
+                        clw_px, clh_px, swin_w_px, swin_h_px,
+                        theor_max_val, patch_slabs, stat_mats, cell_info
                     );
                 }
-                auto label = cell.patch.at<float>(0, 0);
-                std::int32_t int_label = std::round(label);
-                if(!int_label) {
-                    throw std::out_of_range(
-                        fmt::format("invalid cell label, index ({},{}), label: {}", i, j, int_label)
-                    );
-                }
-                auto& cent_img    = mats.at(0).img_p;
-                auto& cent_rum    = mats.at(0).real_p;
-                auto& sub_lab     = mats.at(0).patch;
-                auto& sub_mask    = mats.at(1).patch;
-                auto& sub_raw     = mats.at(2).patch;
-
-                /* Remove the influence from other probes and the interpolation bias under
-                   the subpixel-level domain. */
-                cv::Mat int_sub_lab(sub_lab.size(), CV_32S);
-                sub_lab -= 0.4;
-                sub_lab.convertTo(int_sub_lab, CV_32S);
-                sub_lab = lab_to_mask(int_sub_lab, int_label);
-                sub_mask = sub_mask == 255;
-                cv::Mat sum_mask = sub_mask & sub_lab;
-				
-                cv::threshold(sub_raw, sub_raw, theor_max_val, 0, cv::THRESH_TRUNC);
-                // tmp_timer1 = std::chrono::steady_clock::now();
-
-                /* Use the given small window (swin_w_px, swin_h_px) to compute the desired 
-                   statistics (sub_mean, sub_mean_2, sub_var) for that probe.*/
-                auto [sub_mean, sub_mean_2, sub_var] = make_cell_stats(sub_raw, theor_max_val, swin_w_px, swin_h_px);
-                // d1 += std::chrono::steady_clock::now() - tmp_timer1;
-                cv::Mat sub_cv_2           = sub_var / sub_mean_2;
-                cv::patchNaNs(sub_cv_2, 0.0);
-                
-                /* Stack up the information, extract the intensity that is the most robust 
-                   (min_cv_pos) in this pure probe convolution region as the representative
-                   of this probe and store the information (stat_mats, cell_info) for the 
-                   downstream analysis and summary. */
-                cv::Point min_cv_pos; // pixel domain
-                double min_cv_2;
-                cv::minMaxLoc(sub_cv_2, &min_cv_2, nullptr, &min_cv_pos, nullptr, sum_mask);
-                stat_mats.mean  (i, j)  = sub_mean.template at<Float>(min_cv_pos);
-                stat_mats.stddev(i, j)  = std::sqrt(sub_var.template at<Float>(min_cv_pos));
-                stat_mats.cv    (i, j)  = std::sqrt(min_cv_2);
-                stat_mats.bg    (i, j)  = 0;
-                stat_mats.num   (i, j)  = swin_w_px * swin_h_px;
-                stat_mats.min_cv_pos(i, j) = min_cv_pos;
-
-                /* Generate the mincv debug images. */
-                if(v_margin){
-                    cv::Point pb_img_tl(std::ceil(cent_img.x - clw_px/2.0),
-                                        std::ceil(cent_img.y - clh_px/2.0));
-                    cv::Point pb_swin_tl(pb_img_tl.x + min_cv_pos.x - swin_w_px/2,
-                                         pb_img_tl.y + min_cv_pos.y - swin_h_px/2);
-                    cv::Rect rect(pb_swin_tl.x, pb_swin_tl.y, swin_w_px, swin_h_px);
-                    cv::rectangle(mat_clone, rect, 65536/2);
-                }
-
-                // ip_convert(sum_mask, CV_32F, 1.0 / 255);
-                cell_info     (i, j)  = {sub_raw, cent_img, cent_rum};
-                mats.clear();
             }
-        }
+        });
         // d = std::chrono::steady_clock::now() - tmp_timer;
         // std::cout << "calculate stat_mat: " << d1.count() << " ms\n";
         // chipimgproc::log.info("chipimgproc::warped_mat::MakeStatMat::operator()(...) - calculate cell_mat: {} ms", d.count());
 
-        /* Output the mincv debug images. */
+        /* Generate and output the mincv debug images. */
         if(v_margin){
-            v_margin(mat_clone);
+            for(std::size_t ch = 0; ch < chn; ch ++) {
+                cv::Mat mat_clone;
+                channels[ch].convertTo(mat_clone, CV_16U);
+                for(int i = 0; i < clhn; i ++) {
+                    for(int j = 0; j < clwn; j ++) {
+                        auto& cent_img = cell_info[ch](i, j).img_p;
+                        cv::Point min_cv_pos = stat_mats[ch].min_cv_pos(i, j);
+                        cv::Point pb_img_tl(std::ceil(cent_img.x - clw_px/2.0),
+                                            std::ceil(cent_img.y - clh_px/2.0));
+                        cv::Point pb_swin_tl(pb_img_tl.x + min_cv_pos.x - swin_w_px/2,
+                                             pb_img_tl.y + min_cv_pos.y - swin_h_px/2);
+                        cv::Rect rect(pb_swin_tl.x, pb_swin_tl.y, swin_w_px, swin_h_px);
+                        cv::rectangle(mat_clone, rect, 65536/2);
+                    }
+                }
+                v_margin(mat_clone);
+            }
         }
 
         /* Return a tuple of the created containers. */
         return nucleona::make_tuple(std::move(stat_mats), std::move(cell_info));
     }
+    /**
+     * @brief Set the number of worker threads used to extract the probes.
+     * @details The probe grid is split into row blocks, one block per thread.
+     *          The default value 1 runs the original serial loop.
+     *          The result does not depend on the thread number.
+     * 
+     * @param n Number of worker threads.
+     */
+    void set_thread_num(int n) {
+        thread_num_ = std::max(n, 1);
+    }
+    int thread_num() const {
+        return thread_num_;
+    }
+    /**
+     * @brief Enable/disable the whole FOV statistics mode.
+     * @details In this mode the windowed mean, variance and CV maps are computed 
+     *          once for the whole image with separable box filters, and each probe 
+     *          only samples the maps at its subpixel position. This replaces the 
+     *          per-probe filter2D passes and cuts the extraction time by an order 
+     *          of magnitude on large FOVs.
+     *          The interpolation is linear, so at a given window position the mean 
+     *          equals the box mean of the per-probe patch up to float rounding, 
+     *          except for the windows touching the patch border (the per-probe 
+     *          mode reflects the patch there, this mode uses the real neighbours) 
+     *          and the windows covering pixels above theor_max_val (truncated 
+     *          before instead of after the interpolation). The variance and CV 
+     *          are interpolated from the full resolution maps instead of computed 
+     *          on the interpolated patch, so they differ at subpixel probe 
+     *          positions, and the selected min CV position, thus the reported 
+     *          mean, can differ from the per-probe mode.
+     * 
+     * @param enable true to enable the whole FOV mode, by default it is disabled.
+     */
+    void set_whole_fov_stat(bool enable) {
+        whole_fov_stat_ = enable;
+    }
+    bool whole_fov_stat() const {
+        return whole_fov_stat_;
+    }
+    /**
+     * @brief Enable/disable the analytic probe label mode.
+     * @details By default the pure probe convolution regions are labeled by 
+     *          cv::connectedComponents on the full resolution large mask. In 
+     *          the analytic mode the probe of each pixel is computed from the 
+     *          affine probe grid (origin, clwd, clhd, warpmat) by 
+     *          chipimgproc::warped_mat::ProbeLabel, which skips the full image 
+     *          labelling pass and the int32 label image. The selected pure 
+     *          regions are the same as the connected component labelling. 
+     *          Only the label numbers of the v_comp debug image differ, they 
+     *          follow the probe grid order (i * clwn + j + 1).
+     * 
+     * @param enable true to enable the analytic label mode, by default it is disabled.
+     */
+    void set_analytic_label(bool enable) {
+        analytic_label_ = enable;
+    }
+    bool analytic_label() const {
+        return analytic_label_;
+    }
+    /**
+     * @brief Enable/disable the fused partial mask mode of the large mask generation.
+     *        See chipimgproc::warped_mat::MakeMask::set_fuse_partial_mask.
+     *        The compiled mask graphs are kept in this object, so reusing the same 
+     *        MakeStatMat across FOVs with the same geometry skips the graph compilation.
+     */
+    void set_fuse_partial_mask(bool enable) {
+        make_large_mask.set_fuse_partial_mask(enable);
+    }
+    /**
+     * @brief Enable/disable the grid remap mode.
+     * @details Instead of sampling every probe patch with cv::getRectSubPix, each 
+     *          layer (labels, mask, raw image and the statistics maps) is rectified 
+     *          once by chipimgproc::warped_mat::GridRemap and the probe patches are 
+     *          plain ROI views. The remap maps are kept for the last geometry, so 
+     *          repeated channels of the same FOV only pay the remap. The bilinear 
+     *          weights of the remap are quantized to 1/32 pixel.
+     * 
+     * @param enable true to enable the grid remap mode, by default it is disabled.
+     */
+    void set_grid_remap(bool enable) {
+        if(!enable) {
+            grid_remap_cache_.reset();
+        } else if(!grid_remap_cache_) {
+            grid_remap_cache_ = std::make_shared<GridRemapCache>();
+        }
+    }
+    /**
+     * @brief Set the large mask cache shared across FOVs.
+     * @details See chipimgproc::warped_mat::LargeMaskCache. The same cache object 
+     *          can be shared by several MakeStatMat objects and worker threads.
+     *          By default no cache is used.
+     * 
+     * @param cache The cache object, nullptr to disable the cache.
+     */
+    void set_large_mask_cache(std::shared_ptr<LargeMaskCache> cache) {
+        large_mask_cache_ = std::move(cache);
+    }
+    const std::shared_ptr<LargeMaskCache>& large_mask_cache() const {
+        return large_mask_cache_;
+    }
+    /**
+     * @brief Select the execution backend of the large mask generation.
+     *        See chipimgproc::warped_mat::MakeMask::set_backend.
+     */
+    void set_mask_backend(MaskBackend backend, int strip_rows = 64) {
+        make_large_mask.set_backend(backend, strip_rows);
+    }
+    /**
+     * @brief Select how the raw probe patches of the output cell information are stored.
+     * @details By default (PatchStorage::per_probe) each probe owns a small cv::Mat, 
+     *          which is one heap block per probe. PatchStorage::slab stores all patches 
+     *          of a channel as tiles of one contiguous buffer and each RawPatch::patch is 
+     *          a view of its tile. PatchStorage::none drops the raw patches for callers 
+     *          that only need the statistics, the probe positions are still kept.
+     * 
+     * @param storage The storage mode.
+     */
+    void set_patch_storage(PatchStorage storage) {
+        patch_storage_ = storage;
+    }
+    PatchStorage patch_storage() const {
+        return patch_storage_;
+    }
 private:
+    template<class WarpedAggMat>
+    void extract_cell(
+        const WarpedAggMat&                 warped_agg_mat,
+        const ProbeLabel&                   probe_label,
+        const GridRemap*                    grid_remap,
+        const std::vector<cv::Mat>&         rectified,
+        RawPatch&                           cell,
+        std::vector<RawPatch>&              mats,
+        int i,          int j,
+        int clw_px,     int clh_px,
+        int swin_w_px,  int swin_h_px,
+        double                              theor_max_val,
+        const std::vector<cv::Mat>&         patch_slabs,
+        std::vector<stat::Mats<Float>>&                 stat_mats,
+        std::vector<ObjMat<RawPatch, std::int32_t>>&    cell_info
+    ) const {
+        /* Get the label ID from the corresponding large warped mask and compute the 
+           subpixel-level information (positions (cent_img, cent_rum), pure probe 
+           convolution region (sub_lab, sub_mask), ROI raw image (sub_raw)) for that 
+           probe. */
+        const int chn     = stat_mats.size();
+        const int mask_i  = analytic_label_ ? 0 : 1;
+        const int raw_i0  = mask_i + 1;
+        const int stat_i0 = raw_i0 + chn;
+        if(!warped_agg_mat.sample_cell(
+            cell, i, j, 0, cv::Size(1, 1)
+        )) {
+            throw std::out_of_range(
+                fmt::format("invalid cell index ({},{})", i, j)
+            );
+        }
+        if(grid_remap) {
+            if(!grid_remap->valid(i, j)) {
+                throw std::out_of_range(
+                    fmt::format("invalid cell index ({},{})", i, j)
+                );
+            }
+            auto rect = grid_remap->cell_rect(i, j);
+            mats.resize(rectified.size());
+            for(std::size_t k = 0; k < rectified.size(); k ++) {
+                mats[k].patch  = rectified[k](rect);
+                mats[k].img_p  = grid_remap->cell_center(i, j);
+                mats[k].real_p = grid_remap->cell_real_center(i, j);
+            }
+        } else if(!warped_agg_mat.sample_cell_all(
+            mats, i, j, cv::Size(clw_px, clh_px)
+        )) {
+            throw std::out_of_range(
+                fmt::format("invalid cell index ({},{})", i, j)
+            );
+        }
+        std::int32_t int_label;
+        if(analytic_label_) {
+            int_label = cell.patch.at<std::uint8_t>(0, 0) ? probe_label.label(i, j) : 0;
+        } else {
+            auto label = cell.patch.at<float>(0, 0);
+            int_label = std::round(label);
+        }
+        if(!int_label) {
+            throw std::out_of_range(
+                fmt::format("invalid cell label, index ({},{}), label: {}", i, j, int_label)
+            );
+        }
+        auto& cent_img    = mats.at(0).img_p;
+        auto& cent_rum    = mats.at(0).real_p;
+        auto& sub_mask    = mats.at(mask_i).patch;
+
+        /* Remove the influence from other probes and the interpolation bias under
+           the subpixel-level domain. */
+        cv::Mat sub_lab;
+        if(analytic_label_) {
+            probe_label.make_patch_mask(sub_lab, cent_img, sub_mask.size(), i, j);
+        } else {
+            sub_lab = mats.at(0).patch;
+            cv::Mat int_sub_lab(sub_lab.size(), CV_32S);
+            sub_lab -= 0.4;
+            sub_lab.convertTo(int_sub_lab, CV_32S);
+            sub_lab = lab_to_mask(int_sub_lab, int_label);
+        }
+        cv::compare(sub_mask, 255, sub_mask, cv::CMP_EQ);
+        auto& sum_mask = sub_mask;
+        cv::bitwise_and(sub_mask, sub_lab, sum_mask);
+
+        /* The label and mask above are shared by all channels. */
+        for(int ch = 0; ch < chn; ch ++) {
+            const int stat_i  = stat_i0 + 3 * ch;
+            auto& sub_raw     = mats.at(raw_i0 + ch).patch;
+            cv::threshold(sub_raw, sub_raw, theor_max_val, 0, cv::THRESH_TRUNC);
+
+            /* Use the given small window (swin_w_px, swin_h_px) to compute the desired 
+               statistics (sub_mean, sub_var, sub_cv_2) for that probe. In the whole FOV 
+               mode the statistics are sampled from the precomputed maps instead.*/
+            cv::Mat sub_mean, sub_var, sub_cv_2;
+            Float px_mean, px_var;
+            if(whole_fov_stat_) {
+                sub_mean = mats.at(stat_i    ).patch;
+                sub_var  = mats.at(stat_i + 1).patch;
+                sub_cv_2 = mats.at(stat_i + 2).patch;
+            } else {
+                auto [x_mean, x_mean_2, x_var] = make_cell_stats(sub_raw, theor_max_val, swin_w_px, swin_h_px);
+                sub_mean = x_mean;
+                sub_var  = x_var;
+                sub_cv_2 = sub_var / x_mean_2;
+                cv::patchNaNs(sub_cv_2, 0.0);
+            }
+        
+            /* Stack up the information, extract the intensity that is the most robust 
+               (min_cv_pos) in this pure probe convolution region as the representative
+               of this probe and store the information (stat_mats, cell_info) for the 
+               downstream analysis and summary. */
+            cv::Point min_cv_pos; // pixel domain
+            double min_cv_2;
+            cv::minMaxLoc(sub_cv_2, &min_cv_2, nullptr, &min_cv_pos, nullptr, sum_mask);
+            if(whole_fov_stat_) {
+                px_mean = sub_mean.template at<float>(min_cv_pos);
+                px_var  = sub_var .template at<float>(min_cv_pos);
+            } else {
+                px_mean = sub_mean.template at<Float>(min_cv_pos);
+                px_var  = sub_var .template at<Float>(min_cv_pos);
+            }
+            stat_mats[ch].mean  (i, j)  = px_mean;
+            stat_mats[ch].stddev(i, j)  = std::sqrt(px_var);
+            stat_mats[ch].cv    (i, j)  = std::sqrt(min_cv_2);
+            stat_mats[ch].bg    (i, j)  = 0;
+            stat_mats[ch].num   (i, j)  = swin_w_px * swin_h_px;
+            stat_mats[ch].min_cv_pos(i, j) = min_cv_pos;
+
+            switch(patch_storage_) {
+                case PatchStorage::slab: {
+                    cv::Mat tile = patch_slabs[ch](cv::Rect(
+                        j * sub_raw.cols, i * sub_raw.rows, sub_raw.cols, sub_raw.rows
+                    ));
+                    // no-op if the tile is already sub_raw (grid remap mode)
+                    sub_raw.convertTo(tile, tile.type());
+                    cell_info[ch](i, j) = {tile, cent_img, cent_rum};
+                    break;
+                }
+                case PatchStorage::none:
+                    cell_info[ch](i, j) = {cv::Mat(), cent_img, cent_rum};
+                    break;
+                default:
+                    cell_info[ch](i, j) = {sub_raw, cent_img, cent_rum};
+                    // the raw patch is kept by cell_info, detach it from the reused buffers
+                    sub_raw = cv::Mat();
+                    break;
+            }
+        }
+    }
     cv::Mat lab_to_mask(cv::Mat lab, std::int32_t i) const {
         return lab == i;
     }
@@ -324,6 +684,33 @@ private:
             std::move(var)
         );
     }
+    auto make_fov_stats(
+        cv::Mat mat, double theor_max_val, int conv_w, int conv_h
+    ) const {
+        cv::Size ksize(conv_w, conv_h);
+        cv::Mat x;
+        mat.convertTo(x, CV_32F);
+        cv::threshold(x, x, theor_max_val, 0, cv::THRESH_TRUNC);
+
+        cv::Mat x_mean;
+        cv::boxFilter(x, x_mean, CV_32F, ksize);
+        trim_zero_maximum(x_mean, x_mean, theor_max_val);
+        cv::Mat x_mean_2 = x_mean.mul(x_mean);
+        cv::threshold(x_mean_2, x_mean_2, theor_max_val*theor_max_val, 0, cv::THRESH_TRUNC);
+        cv::Mat x_2_mean;
+        cv::sqrBoxFilter(x, x_2_mean, CV_32F, ksize);
+        trim_zero_maximum(x_2_mean, x_2_mean, theor_max_val*theor_max_val);
+        cv::Mat var      = x_2_mean - x_mean_2;
+        cv::threshold(var, var, 0, 0, cv::THRESH_TOZERO);
+        cv::Mat cv_2     = var / x_mean_2;
+        cv::patchNaNs(cv_2, 0.0);
+
+        return nucleona::make_tuple(
+            std::move(x_mean),
+            std::move(var),
+            std::move(cv_2)
+        );
+    }
     void trim_zero_maximum(cv::InputArray src,cv::OutputArray dst, double theor_max_value) const {
         cv::threshold(src, dst, theor_max_value, 0, cv::THRESH_TRUNC);
         cv::threshold(dst, dst, 0, 0, cv::THRESH_TOZERO);
@@ -335,7 +722,13 @@ private:
         kern.setTo(1.0 / (conv_w * conv_h));
         return filter2D(mat, kern, type_to_depth<Float>());
     } 
-    MakeMask make_large_mask;
+    MakeMask                        make_large_mask     ;
+    int                             thread_num_         {1};
+    bool                            whole_fov_stat_     {false};
+    bool                            analytic_label_     {false};
+    std::shared_ptr<LargeMaskCache> large_mask_cache_   ;
+    std::shared_ptr<GridRemapCache> grid_remap_cache_   ;
+    PatchStorage                    patch_storage_      {PatchStorage::per_probe};
 };
 
 }
@@ -21,6 +21,14 @@ struct RawPatch
 
     cv::Mat patch;
 };
+/**
+ * @brief The storage mode of the raw probe patches kept in the cell information.
+ */
+enum class PatchStorage {
+    per_probe,  ///< Each probe owns its cv::Mat, the default.
+    slab,       ///< The patches of a channel are views of one contiguous buffer with fixed stride.
+    none        ///< The raw patches are not retained, only the probe positions are kept.
+};
 // struct RawPatch {
 //     cv::Mat patch;
 //     cv::Point2d img_p;
@@ -0,0 +1,151 @@
+/**
+ * @file    probe_label.hpp
+ * @brief   @copybrief chipimgproc::warped_mat::ProbeLabel
+ */
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <ChipImgProc/utils.h>
+namespace chipimgproc::warped_mat {
+
+/**
+ * @brief The ProbeLabel class computes the probe label of image pixels directly
+ *        from the affine probe grid.
+ *
+ * @details The pure probe convolution regions generated by MakeMask are strictly
+ *          inside the warped probe rectangles, and two rectangles never touch.
+ *          Therefore the connected component of a masked pixel is fully determined
+ *          by the grid cell which contains its inverse warped position, and the
+ *          full image labelling pass (cv::connectedComponents) can be replaced by
+ *          an inverse affine transform per pixel.
+ *
+ *          The probe at row i and column j is labeled as i * clwn + j + 1,
+ *          pixels outside the probe grid are labeled as 0.
+ */
+struct ProbeLabel {
+    ProbeLabel() = default;
+    /**
+     * @brief Construct the labeler from the probe grid geometry.
+     *
+     * @param warpmat   The transformation matrix from the um domain to the pixel domain.
+     * @param origin    The origin of the probe grid in the um domain.
+     * @param clwd      The probe width (includes the gap) in the um domain.
+     * @param clhd      The probe height (includes the gap) in the um domain.
+     * @param clwn      Number of probes in a row.
+     * @param clhn      Number of probes in a column.
+     */
+    ProbeLabel(
+        cv::Mat         warpmat,
+        cv::Point2d     origin,
+        double clwd,    double clhd,
+        int clwn,       int clhn
+    )
+    : origin_   (origin)
+    , clwd_     (clwd)
+    , clhd_     (clhd)
+    , clwn_     (clwn)
+    , clhn_     (clhn)
+    {
+        cv::Mat_<double> inv;
+        cv::Mat_<double> fwd;
+        warpmat.convertTo(fwd, CV_64F);
+        cv::invertAffineTransform(fwd, inv);
+        for(int r = 0; r < 2; r ++) {
+            for(int c = 0; c < 3; c ++) {
+                inv_[r][c] = inv(r, c);
+            }
+        }
+    }
+    /**
+     * @brief Get the grid index of the probe which contains the given pixel.
+     *
+     * @param x         Pixel x coordinate.
+     * @param y         Pixel y coordinate.
+     * @param i         Output, probe row.
+     * @param j         Output, probe column.
+     * @return bool     false if the pixel is outside the probe grid.
+     */
+    bool cell_index(double x, double y, int& i, int& j) const {
+        // inverse of the "real - 0.5" shift in Basic::point_transform
+        auto rx = inv_[0][0] * x + inv_[0][1] * y + inv_[0][2] + 0.5;
+        auto ry = inv_[1][0] * x + inv_[1][1] * y + inv_[1][2] + 0.5;
+        j = std::floor((rx - origin_.x) / clwd_);
+        i = std::floor((ry - origin_.y) / clhd_);
+        if(i < 0 || j < 0 || i >= clhn_ || j >= clwn_) return false;
+        return true;
+    }
+    /**
+     * @brief Get the label of the probe (i, j).
+     */
+    std::int32_t label(int i, int j) const {
+        return i * clwn_ + j + 1;
+    }
+    /**
+     * @brief Get the label of the given pixel.
+     */
+    std::int32_t operator()(double x, double y) const {
+        int i, j;
+        if(!cell_index(x, y, i, j)) return 0;
+        return label(i, j);
+    }
+    /**
+     * @brief Generate the mask of the probe (i, j) on a patch sampled by
+     *        cv::getRectSubPix around the center point.
+     *
+     * @details A patch pixel belongs to the probe when its top-left integer
+     *          interpolation neighbour does. Inside the pure convolution region
+     *          all interpolation neighbours share the same component, so the
+     *          mask agrees with the interpolated connected component labels.
+     *
+     * @param sub_lab   Output 8 bit mask, 255 for the pixels of probe (i, j).
+     * @param center    The subpixel center of the patch in the pixel domain.
+     * @param size      The patch size.
+     * @param i         Probe row.
+     * @param j         Probe column.
+     */
+    void make_patch_mask(
+        cv::Mat&        sub_lab,
+        cv::Point2d     center,
+        cv::Size        size,
+        int i,          int j
+    ) const {
+        sub_lab.create(size, CV_8U);
+        auto x0 = center.x - (size.width  - 1) * 0.5;
+        auto y0 = center.y - (size.height - 1) * 0.5;
+        for(int v = 0; v < size.height; v ++) {
+            auto* row = sub_lab.ptr<std::uint8_t>(v);
+            auto y = std::floor(y0 + v);
+            for(int u = 0; u < size.width; u ++) {
+                auto x = std::floor(x0 + u);
+                int pi, pj;
+                row[u] = (cell_index(x, y, pi, pj) && pi == i && pj == j) ? 255 : 0;
+            }
+        }
+    }
+    /**
+     * @brief Generate the full label image of a mask. Only used for debugging,
+     *        the extraction itself does not need the label image.
+     *
+     * @param lmask     The large warped mask.
+     * @return cv::Mat_<std::int32_t> The label image.
+     */
+    cv::Mat_<std::int32_t> label_image(const cv::Mat& lmask) const {
+        cv::Mat_<std::int32_t> res = cv::Mat_<std::int32_t>::zeros(lmask.size());
+        for(int y = 0; y < lmask.rows; y ++) {
+            auto* mrow = lmask.ptr<std::uint8_t>(y);
+            for(int x = 0; x < lmask.cols; x ++) {
+                if(mrow[x]) res(y, x) = operator()(x, y);
+            }
+        }
+        return res;
+    }
+private:
+    double          inv_[2][3]  ;
+    cv::Point2d     origin_     ;
+    double          clwd_       ;
+    double          clhd_       ;
+    int             clwn_       ;
+    int             clhn_       ;
+};
+
+}
@@ -81,6 +81,32 @@ struct RegMatHelper<Derived, true, AtResult> {
         auto [ cent_c, cent_r ] = real_cell_cent(r, c);
         return derived()->at_real_all(res, cent_r, cent_c, patch_size);
     }
+    // buffer reusing version of at_cell_all, see warped_mat::Basic::sample_real_all
+    bool sample_cell_all(
+        std::vector<AtResult>& res,
+        std::int32_t r, 
+        std::int32_t c, 
+        cv::Size patch_size = cv::Size(5, 5)
+    ) const {
+        if(r >= rows()) return false;
+        if(c >= cols()) return false;
+        auto [ cent_c, cent_r ] = real_cell_cent(r, c);
+        return derived()->sample_real_all(res, cent_r, cent_c, patch_size);
+    }
+
+    // buffer reusing version of at_cell, see warped_mat::Basic::sample_real
+    bool sample_cell(
+        AtResult& res,
+        std::int32_t r, 
+        std::int32_t c, 
+        std::int32_t i,
+        cv::Size patch_size = cv::Size(5, 5)
+    ) const {
+        if(r >= rows()) return false;
+        if(c >= cols()) return false;
+        auto [ cent_c, cent_r ] = real_cell_cent(r, c);
+        return derived()->sample_real(res, cent_r, cent_c, i, patch_size);
+    }
     int rows() const { return cl_y_n_; }
     int cols() const { return cl_x_n_; }
 
@@ -0,0 +1,108 @@
+#include <ChipImgProc/hough_transform.hpp>
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <string>
+#include <chrono>
+
+/*
+ *  This example benchmarks the voting engines of chipimgproc::HoughTransform
+ *  (see chipimgproc::HoughEngine) on a synthetic edge image, with the theta
+ *  range used by chipimgproc::rotation::LineDetection.
+ *
+ *  output:
+ *          The mean time of each engine and whether the exact engines
+ *          agree with each other.
+ *
+ *  Example:
+ *          ./Example-hough_vote_benchmark -W 4000 -H 3000 -t 8
+ */
+
+int main( int argc, char** argv )
+{
+    /*
+     *  +=========================+
+     *  | Declare program options |
+     *  +=========================+
+     */
+
+    int     width;          //  The image width
+    int     height;         //  The image height
+    int     thread_num;     //  The voting threads
+    int     repeat;         //  The number of calls of each engine
+    double  edge_ratio;     //  The ratio of the random edge pixels
+    float   steps;          //  The theta steps
+
+    boost::program_options::variables_map op;
+    boost::program_options::options_description options( "Options" );
+
+    options.add_options()( "help,h" , "Print this help messages" )
+        ( "width,W"     , boost::program_options::value< int >( &width )->default_value(2000),         "Image width" )
+        ( "height,H"    , boost::program_options::value< int >( &height )->default_value(2000),        "Image height" )
+        ( "threads,t"   , boost::program_options::value< int >( &thread_num )->default_value(4),       "Voting threads" )
+        ( "repeat,r"    , boost::program_options::value< int >( &repeat )->default_value(5),           "Number of calls of each engine" )
+        ( "edges,e"     , boost::program_options::value< double >( &edge_ratio )->default_value(0.02), "Ratio of the random edge pixels" )
+        ( "steps,s"     , boost::program_options::value< float >( &steps )->default_value(200),        "Theta steps" )
+        ;
+    try {
+        boost::program_options::store( boost::program_options::parse_command_line( argc, argv, options ), op );
+        if( op.count( "help" )) {
+            std::cout << "\n" << options << "\n";
+            exit(0);
+        }
+        boost::program_options::notify( op );
+    }
+    catch( boost::program_options::error& error ) {
+        std::cerr << "\nERROR: " << error.what() << "\n" << options << "\n";
+        exit(1);
+    }
+
+    /*
+     *  +======================+
+     *  | Synthetic edge image |
+     *  +======================+
+     */
+
+    //  Slightly rotated grid lines plus random edge pixels
+    cv::Mat_<std::uint8_t> img = cv::Mat_<std::uint8_t>::zeros(height, width);
+    const double slope = std::tan(0.3 * CV_PI / 180.0);
+    for(int y = 0; y < height; y += 40) {
+        cv::line(img, cv::Point(0, y), cv::Point(width - 1, y + slope * width), cv::Scalar(255));
+    }
+    cv::Mat_<float> noise(img.size());
+    cv::randu(noise, 0, 1);
+    img.setTo(255, noise < edge_ratio);
+
+    // same as LineDetection with the default max_theta
+    const float max_theta = 5;
+    chipimgproc::HoughTransform<float> hough(90 - max_theta, 90 + max_theta, steps);
+    hough.set_thread_num(thread_num);
+
+    /*
+     *  +===========+
+     *  | Benchmark |
+     *  +===========+
+     */
+
+    auto bench = [&](auto&& engine) {
+        auto hist = engine();
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < repeat; i ++) {
+            hist = engine();
+        }
+        std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - start;
+        return std::make_tuple(d.count() / std::max(repeat, 1), hist);
+    };
+    auto [atomic_time,  atomic_hist ] = bench([&]{ return hough(img); });
+    auto [private_time, private_hist] = bench([&]{ return hough.vote(img); });
+    auto [simd_time,    simd_hist   ] = bench([&]{ return hough.vote_simd(img); });
+
+    std::cout << "image size:           " << img.size()                         << '\n'
+              << "edge pixels:          " << cv::countNonZero(img > 127)        << '\n'
+              << "theta bins:           " << hough.unitvecs().size()            << '\n'
+              << "threads:              " << thread_num                         << '\n'
+              << "atomic mean:          " << atomic_time  << " ms"              << '\n'
+              << "private_acc mean:     " << private_time << " ms"              << '\n'
+              << "simd mean:            " << simd_time    << " ms"              << '\n'
+              << "simd == private_acc:  " << (cv::countNonZero(simd_hist != private_hist) == 0) << std::endl;
+    return 0;
+}
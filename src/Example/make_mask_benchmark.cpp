@@ -0,0 +1,148 @@
+#include <ChipImgProc/warped_mat/make_mask.hpp>
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <string>
+#include <chrono>
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+/*
+ *  This example benchmarks the large mask generation backends of
+ *  chipimgproc::warped_mat::MakeMask on a synthetic full FOV.
+ *
+ *  The peak RSS is a per process value, so each backend must be run
+ *  in its own process to be compared.
+ *
+ *  output:
+ *          The first call time (includes the graph compilation),
+ *          the mean time of the cached calls and the process peak RSS.
+ *
+ *  Example:
+ *          for b in gpu cpu strip; do
+ *              ./Example-make_mask_benchmark -b $b
+ *          done
+ */
+
+long peak_rss_kb() {
+#ifdef __unix__
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#else
+    return -1;
+#endif
+}
+
+int main( int argc, char** argv )
+{
+    /*
+     *  +=========================+
+     *  | Declare program options |
+     *  +=========================+
+     */
+
+    std::string backend_name;   //  The mask backend
+    int         repeat;         //  The number of cached calls
+    int         clwn;           //  The probe number of a row/column
+    int         strip_rows;     //  The strip rows of the strip backend
+    bool        fuse;           //  Fuse the 4 partial masks
+
+    boost::program_options::variables_map op;
+    boost::program_options::options_description options( "Options" );
+
+    options.add_options()( "help,h" , "Print this help messages" )
+        ( "backend,b"   , boost::program_options::value< std::string >( &backend_name )->default_value("gpu"), "Mask backend: gpu, cpu or strip" )
+        ( "repeat,r"    , boost::program_options::value< int >( &repeat )->default_value(5),       "Number of cached calls" )
+        ( "probes,n"    , boost::program_options::value< int >( &clwn )->default_value(1000),      "Probe number of a row and a column" )
+        ( "strip-rows,s", boost::program_options::value< int >( &strip_rows )->default_value(64),  "Strip rows of the strip backend" )
+        ( "fuse,f"      , boost::program_options::bool_switch( &fuse ),                            "Fuse the 4 partial masks" )
+        ;
+    try {
+        boost::program_options::store( boost::program_options::parse_command_line( argc, argv, options ), op );
+        if( op.count( "help" )) {
+            std::cout << "\n" << options << "\n";
+            exit(0);
+        }
+        boost::program_options::notify( op );
+    }
+    catch( boost::program_options::error& error ) {
+        std::cerr << "\nERROR: " << error.what() << "\n" << options << "\n";
+        exit(1);
+    }
+
+    /*
+     *  +==========================+
+     *  | Synthetic FOV parameters |
+     *  +==========================+
+     */
+
+    //  Banff like probe geometry, rescaled um domain
+    const int       rescale = 2;
+    const double    um2px_r = 2.4145 / rescale;
+    const int       clw     = 4 * rescale;
+    const int       clh     = 4 * rescale;
+    const int       clwd    = 5 * rescale;
+    const int       clhd    = 5 * rescale;
+    const int       clhn    = clwn;
+    const int       w       = clwn * clwd;
+    const int       h       = clhn * clhd;
+    const double    swin_w  = clw * 0.6;
+    const double    swin_h  = clh * 0.6;
+
+    //  A slightly rotated um to pixel transform
+    const double    theta   = 0.3 * CV_PI / 180.0;
+    cv::Mat_<double> warpmat(2, 3);
+    warpmat(0, 0) =  um2px_r * std::cos(theta);
+    warpmat(0, 1) = -um2px_r * std::sin(theta);
+    warpmat(0, 2) =  20.0;
+    warpmat(1, 0) =  um2px_r * std::sin(theta);
+    warpmat(1, 1) =  um2px_r * std::cos(theta);
+    warpmat(1, 2) =  20.0;
+    cv::Size dsize(
+        std::ceil(w * um2px_r) + 40,
+        std::ceil(h * um2px_r) + 40
+    );
+
+    chipimgproc::warped_mat::MakeMask make_mask;
+    if(backend_name == "gpu") {
+        make_mask.set_backend(chipimgproc::warped_mat::MaskBackend::gpu);
+    } else if(backend_name == "cpu") {
+        make_mask.set_backend(chipimgproc::warped_mat::MaskBackend::cpu);
+    } else if(backend_name == "strip") {
+        make_mask.set_backend(chipimgproc::warped_mat::MaskBackend::strip, strip_rows);
+    } else {
+        std::cerr << "unknown backend: " << backend_name << std::endl;
+        return 1;
+    }
+    make_mask.set_fuse_partial_mask(fuse);
+
+    /*
+     *  +===========+
+     *  | Benchmark |
+     *  +===========+
+     */
+
+    auto run = [&]() {
+        auto start = std::chrono::steady_clock::now();
+        auto mask = make_mask(
+            {0, 0}, clw, clh, clwd, clhd, w, h,
+            swin_w, swin_h, um2px_r, clwn, clhn,
+            warpmat, dsize
+        );
+        std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - start;
+        return std::make_tuple(d.count(), cv::countNonZero(mask));
+    };
+    auto [first_time, first_nz] = run();
+    double cached_time = 0;
+    for(int i = 0; i < repeat; i ++) {
+        cached_time += std::get<0>(run());
+    }
+    std::cout << "backend:          " << backend_name                   << '\n'
+              << "fov size:         " << dsize                          << '\n'
+              << "mask pixels:      " << first_nz                       << '\n'
+              << "first call:       " << first_time << " ms"            << '\n'
+              << "cached call mean: " << cached_time / std::max(repeat, 1) << " ms" << '\n'
+              << "peak RSS:         " << peak_rss_kb() << " KB"         << std::endl;
+    return 0;
+}
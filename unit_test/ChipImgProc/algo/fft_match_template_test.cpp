@@ -0,0 +1,118 @@
+#include <ChipImgProc/algo/fft_match_template.hpp>
+#include <Nucleona/app/cli/gtest.hpp>
+
+namespace {
+cv::Mat_<std::uint8_t> make_templ() {
+    cv::Mat_<std::uint8_t> templ(21, 17);
+    cv::randu(templ, 0, 255);
+    return templ;
+}
+cv::Mat_<std::uint8_t> make_mask(cv::Size size) {
+    cv::Mat_<std::uint8_t> mask(size, 255);
+    cv::circle(mask, cv::Point(size.width / 2, size.height / 2), 4, 0, -1);
+    return mask;
+}
+void expect_near(const cv::Mat_<float>& res, const cv::Mat_<float>& ref) {
+    ASSERT_EQ(res.size(), ref.size());
+    EXPECT_LT(cv::norm(res, ref, cv::NORM_INF), 1e-4);
+    cv::Point p0, p1;
+    cv::minMaxLoc(res, nullptr, nullptr, nullptr, &p0);
+    cv::minMaxLoc(ref, nullptr, nullptr, nullptr, &p1);
+    EXPECT_EQ(p0, p1);
+}
+}
+
+TEST(fft_match_template, masked_ccorr_normed) {
+    auto templ = make_templ();
+    auto mask  = make_mask(templ.size());
+    cv::Mat_<std::uint8_t> img(97, 123);
+    cv::randu(img, 0, 255);
+    templ.copyTo(img(cv::Rect(40, 30, templ.cols, templ.rows)));
+
+    chipimgproc::algo::FFTMatchTemplate match(templ, mask);
+    expect_near(
+        match(img),
+        chipimgproc::match_template(img, templ, cv::TM_CCORR_NORMED, mask)
+    );
+    // the spectra are reused by another image of the same size, also by copies
+    cv::randu(img, 0, 255);
+    auto copy = match;
+    expect_near(
+        copy(img),
+        chipimgproc::match_template(img, templ, cv::TM_CCORR_NORMED, mask)
+    );
+    EXPECT_EQ(match.cached_sizes(), 1u);
+}
+
+TEST(fft_match_template, unmasked) {
+    auto templ = make_templ();
+    cv::Mat_<std::uint8_t> img(64, 80);
+    cv::randu(img, 0, 255);
+    img(cv::Rect(0, 0, 30, 30)).setTo(0); // empty windows
+    templ.copyTo(img(cv::Rect(50, 33, templ.cols, templ.rows)));
+
+    chipimgproc::algo::FFTMatchTemplate normed(templ);
+    expect_near(
+        normed(img),
+        chipimgproc::match_template(img, templ, cv::TM_CCORR_NORMED)
+    );
+
+    // raw correlations, compared relative to the peak
+    chipimgproc::algo::FFTMatchTemplate ccorr(templ, cv::Mat(), cv::TM_CCORR);
+    cv::Mat_<float> ref = chipimgproc::match_template(img, templ, cv::TM_CCORR);
+    cv::Mat_<float> res = ccorr(img);
+    auto peak = cv::norm(ref, cv::NORM_INF);
+    expect_near(res / peak, ref / peak);
+}
+
+TEST(fft_match_template, masked_ccorr) {
+    auto templ = make_templ();
+    cv::Mat_<std::uint8_t> img(97, 123);
+    cv::randu(img, 0, 255);
+    templ.copyTo(img(cv::Rect(40, 30, templ.cols, templ.rows)));
+
+    // a 0/255 mask with interpolated borders, as the rotated marker masks
+    cv::Mat_<std::uint8_t> mask;
+    cv::GaussianBlur(make_mask(templ.size()), mask, cv::Size(3, 3), 0);
+    ASSERT_GT(cv::countNonZero((mask != 0) & (mask != 255)), 0);
+
+    chipimgproc::algo::FFTMatchTemplate ccorr(templ, mask, cv::TM_CCORR);
+    cv::Mat_<float> ref = chipimgproc::match_template(img, templ, cv::TM_CCORR, mask);
+    cv::Mat_<float> res = ccorr(img);
+    auto peak = cv::norm(ref, cv::NORM_INF);
+    expect_near(res / peak, ref / peak);
+
+    chipimgproc::algo::FFTMatchTemplate normed(templ, mask);
+    expect_near(
+        normed(img),
+        chipimgproc::match_template(img, templ, cv::TM_CCORR_NORMED, mask)
+    );
+}
+
+TEST(fft_match_template, matcher_cache) {
+    auto templ = make_templ();
+    auto mask = make_mask(templ.size());
+    cv::Mat_<std::uint8_t> img(64, 64);
+    cv::randu(img, 0, 255);
+
+    chipimgproc::algo::FFTMatchTemplateCache cache;
+    int made = 0;
+    auto make = [&](){
+        made ++;
+        return chipimgproc::algo::FFTMatchTemplate(templ, mask);
+    };
+    auto first = cache.get(templ, mask, 0, make);
+    first(img);
+    // the same template and mask share the matcher and its spectra
+    auto second = cache.get(templ, mask, 0, make);
+    EXPECT_EQ(made, 1);
+    EXPECT_EQ(second.cached_sizes(), 1u);
+    EXPECT_EQ(cv::norm(first(img), second(img), cv::NORM_INF), 0);
+    // another tag or another template is another matcher
+    cache.get(templ, mask, 0.5, make);
+    cache.get(templ.clone(), mask, 0, make);
+    EXPECT_EQ(made, 3);
+    EXPECT_EQ(cache.size(), 3u);
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0u);
+}
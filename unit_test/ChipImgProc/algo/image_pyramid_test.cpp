@@ -0,0 +1,37 @@
+#include <ChipImgProc/algo/image_pyramid.hpp>
+#include <Nucleona/app/cli/gtest.hpp>
+
+TEST(image_pyramid, levels_and_regions) {
+    cv::Mat_<std::uint16_t> img(203, 317);
+    cv::randu(img, 0, 16383);
+    chipimgproc::algo::ImagePyramid pyramid(
+        img, 3, 16383, chipimgproc::algo::ImagePyramid::clip_to_mean
+    );
+    ASSERT_EQ(pyramid.levels(), 3);
+
+    cv::Mat_<std::uint8_t> expected;
+    img.convertTo(expected, CV_8U, 255.0 / 16383);
+    expected = cv::max(expected, cv::mean(expected)[0]);
+    for(int i = 0; i <= pyramid.levels(); i ++) {
+        if(i > 0) {
+            cv::Mat_<std::uint8_t> tmp;
+            cv::pyrDown(expected, tmp);
+            expected = tmp;
+        }
+        ASSERT_EQ(pyramid.level(i).size(), expected.size());
+        EXPECT_EQ(cv::norm(pyramid.level(i), expected, cv::NORM_INF), 0);
+    }
+    EXPECT_THROW(pyramid.level(4), std::out_of_range);
+
+    // the region view covers the level 0 rectangle
+    cv::Rect roi(13, 21, 50, 37);
+    auto rect = pyramid.region_rect(2, roi);
+    EXPECT_EQ(rect, cv::Rect(3, 5, 13, 10));
+    auto view = pyramid.region(2, roi);
+    EXPECT_EQ(view.data, pyramid.level(2).ptr(5, 3));
+    // clipped by the level size
+    EXPECT_EQ(
+        pyramid.region_rect(1, cv::Rect(300, 190, 40, 40)), 
+        cv::Rect(150, 95, 9, 7)
+    );
+}
@@ -0,0 +1,32 @@
+#include <ChipImgProc/algo/scaled_match_template.hpp>
+#include <Nucleona/app/cli/gtest.hpp>
+#include <Nucleona/test/data_dir.hpp>
+#include "../make_layout.hpp"
+
+TEST(scaled_match_template, pyramid_max) {
+    auto mk_layout = make_banff_layout("banff_rc/pat_CY3.tsv", 2.68);
+    auto& mk_des = mk_layout.get_marker_des(0, 0);
+    cv::Mat_<std::uint8_t> templ = mk_des.get_std_mk(chipimgproc::MatUnit::PX);
+    cv::Mat_<std::uint8_t> mask  = mk_des.get_std_mk_mask(chipimgproc::MatUnit::PX);
+    for(auto&& name : {"0-0-2.tiff", "0-1-2.tiff", "1-1-2.tiff"}) {
+        cv::Mat img = cv::imread(
+            (nucleona::test::data_dir() / "banff_test" / name).string(),
+            cv::IMREAD_ANYCOLOR | cv::IMREAD_ANYDEPTH
+        );
+        // the 3x3 marker layout has its middle marker at the image center
+        cv::Rect roi(
+            img.cols / 2 - templ.cols * 2, img.rows / 2 - templ.rows * 2,
+            templ.cols * 4, templ.rows * 4
+        );
+        chipimgproc::algo::ImagePyramid pyramid(img(roi), 2, 16383);
+        cv::Mat_<float> score(pyramid.level(0).size());
+        cv::Mat_<float> pyramid_score(pyramid.level(0).size());
+        chipimgproc::algo::scaled_match_template.max(
+            pyramid.level(0), templ, score, CV_TM_CCORR_NORMED, 2, mask
+        );
+        chipimgproc::algo::scaled_match_template.max(
+            pyramid, templ, pyramid_score, CV_TM_CCORR_NORMED, 2, mask
+        );
+        EXPECT_EQ(cv::norm(score, pyramid_score, cv::NORM_INF), 0) << name;
+    }
+}
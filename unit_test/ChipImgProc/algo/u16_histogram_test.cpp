@@ -0,0 +1,42 @@
+#include <ChipImgProc/algo/u16_histogram.hpp>
+#include <ChipImgProc/algo/partial_percentile.hpp>
+#include <ChipImgProc/utils/percentile.hpp>
+#include <Nucleona/app/cli/gtest.hpp>
+#include <numeric>
+TEST(u16_histogram, order_statistics) {
+    cv::Mat_<std::uint16_t> img(37, 41);
+    cv::randu(img, 0, 65535);
+    img(cv::Rect(0, 0, 5, 5)).setTo(1234); // duplicated values
+    std::vector<std::uint16_t> sorted(img.begin(), img.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    chipimgproc::algo::U16Histogram hist;
+    hist.add(cv::Mat_<std::uint16_t>::zeros(3, 3)); // cleared below
+    hist.clear();
+    hist.add(img);
+    ASSERT_EQ(hist.size(), sorted.size());
+    std::uint64_t sum = 0;
+    for(std::size_t k = 0; k < sorted.size(); k ++) {
+        EXPECT_EQ(hist.select(k), sorted[k]);
+        EXPECT_EQ(hist.prefix_sum(k), sum);
+        sum += sorted[k];
+    }
+    EXPECT_EQ(hist.prefix_sum(sorted.size()), sum);
+
+    // the uint16 paths agree with the generic ones
+    std::vector<int> int_vec(sorted.begin(), sorted.end());
+    std::vector<std::uint16_t> u16_vec(img.begin(), img.end());
+    for(double p : {0.0, 5.0, 33.3, 50.0, 95.0}) {
+        auto tmp = int_vec;
+        EXPECT_DOUBLE_EQ(
+            chipimgproc::utils::percentile(u16_vec, p), 
+            chipimgproc::utils::percentile(tmp, p)
+        );
+    }
+    chipimgproc::PartialPercentile<std::uint16_t> u16_pp;
+    chipimgproc::PartialPercentile<int> int_pp;
+    std::vector<int> int_vals(img.begin(), img.end());
+    for(double q : {0.0, 0.05, 0.5, 0.9, 1.0}) {
+        EXPECT_DOUBLE_EQ(u16_pp(u16_vec, q), int_pp(int_vals, q));
+    }
+}
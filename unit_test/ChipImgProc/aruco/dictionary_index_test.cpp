@@ -0,0 +1,59 @@
+#include <ChipImgProc/aruco/dictionary_index.hpp>
+#include <Nucleona/app/cli/gtest.hpp>
+#include <numeric>
+#include <random>
+
+TEST(dictionary_index, same_as_linear_scan) {
+    namespace aruco = chipimgproc::aruco;
+    std::mt19937_64 rng(7);
+    aruco::Dictionary dict(6, 5);
+    for(int i = 0; i < 250; i ++) {
+        dict.push_back(rng() & ((1ull << 36) - 1));
+    }
+    dict[17] = dict[3]; // identical codes, the first candidate wins
+
+    std::vector<std::int32_t> candidates;
+    for(int i = 0; i < 120; i ++) {
+        candidates.push_back(rng() % dict.size());
+    }
+    candidates.push_back(3);
+    candidates.push_back(17);
+    aruco::DictionaryIndex index(dict, candidates);
+
+    for(int q = 0; q < 5000; q ++) {
+        std::uint64_t query = dict[candidates[rng() % candidates.size()]];
+        auto flips = rng() % 9;
+        for(std::uint64_t f = 0; f < flips; f ++) {
+            query ^= 1ull << (rng() % 36);
+        }
+        if(q % 10 == 0) query = rng(); // including the bits out of the code
+        for(std::int32_t maxcor : {-1, 0, 1, 3, 5, 12, 40}) {
+            EXPECT_EQ(
+                index.identify(query, maxcor),
+                dict.identify(query, candidates, maxcor)
+            );
+        }
+    }
+}
+
+TEST(dictionary_index, compute_maxcor_bits) {
+    namespace aruco = chipimgproc::aruco;
+    std::mt19937_64 rng(11);
+    aruco::Dictionary dict(6, 5);
+    for(int i = 0; i < 100; i ++) {
+        dict.push_back(rng() & ((1ull << 36) - 1));
+    }
+    std::vector<std::int32_t> ids(60);
+    std::iota(ids.begin(), ids.end(), 10);
+    std::int32_t min_distance = 36;
+    for(std::size_t j = 1; j < ids.size(); j ++) {
+        for(std::size_t i = 0; i < j; i ++) {
+            min_distance = std::min(
+                min_distance, aruco::Utils::bit_count(dict[ids[i]] ^ dict[ids[j]])
+            );
+        }
+    }
+    EXPECT_EQ(dict.compute_maxcor_bits(ids), min_distance / 2);
+    ids.push_back(ids.front());
+    EXPECT_THROW(dict.compute_maxcor_bits(ids), std::invalid_argument);
+}
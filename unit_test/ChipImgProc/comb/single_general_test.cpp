@@ -275,3 +275,95 @@ TEST(single_image_general_gridding, yz01_test) {
     multi_tiled_mat.dump().convertTo(md, CV_16U, 1);
     cv::imwrite("means_dump.tiff", chipimgproc::viewable(md));
 }
+TEST(single_image_general_gridding, lazy_rotation_test) {
+    using FLOAT = float;
+    auto p = nucleona::test::data_dir() / "C018_2017_11_30_18_14_23" / "0-0-2.tiff";
+    cv::Mat img = cv::imread(p.string(), cv::IMREAD_ANYCOLOR | cv::IMREAD_ANYDEPTH);
+    cv::Mat org = img.clone();
+
+    auto gridder = get_zion_gridder(2.68);
+    auto [qc, tiled_mat, stat_mats, theta, bg_value] = gridder(img);
+
+    auto lazy_gridder = get_zion_gridder(2.68);
+    lazy_gridder.set_lazy_rotation(true);
+    auto [lazy_qc, lazy_tiled_mat, lazy_stat_mats, lazy_theta, lazy_bg_value] = lazy_gridder(img);
+
+    // the input image is not modified
+    EXPECT_EQ(cv::countNonZero(img != org), 0);
+    EXPECT_FLOAT_EQ(theta, lazy_theta);
+    EXPECT_EQ(tiled_mat.rows(), lazy_tiled_mat.rows());
+    EXPECT_EQ(tiled_mat.cols(), lazy_tiled_mat.cols());
+    // the lazy result is the grid region of the rotated FOV, the grid lines and 
+    // tiles are all shifted by the region origin
+    auto& glx = tiled_mat.glx();
+    auto& gly = tiled_mat.gly();
+    auto& lazy_glx = lazy_tiled_mat.glx();
+    auto& lazy_gly = lazy_tiled_mat.gly();
+    ASSERT_EQ(glx.size(), lazy_glx.size());
+    ASSERT_EQ(gly.size(), lazy_gly.size());
+    cv::Rect roi(
+        glx.front() - lazy_glx.front(), 
+        gly.front() - lazy_gly.front(),
+        lazy_tiled_mat.get_cali_img().cols,
+        lazy_tiled_mat.get_cali_img().rows
+    );
+    // the region origin is the floor of the first grid line
+    EXPECT_GE(roi.x, glx.front() - 1);
+    EXPECT_LE(roi.x, glx.front());
+    EXPECT_GE(roi.y, gly.front() - 1);
+    EXPECT_LE(roi.y, gly.front());
+    for(std::size_t i = 0; i < glx.size(); i ++) {
+        EXPECT_EQ(lazy_glx[i], glx[i] - roi.x);
+    }
+    for(std::size_t i = 0; i < gly.size(); i ++) {
+        EXPECT_EQ(lazy_gly[i], gly[i] - roi.y);
+    }
+    auto& tiles = tiled_mat.get_tiles();
+    auto& lazy_tiles = lazy_tiled_mat.get_tiles();
+    ASSERT_EQ(tiles.size(), lazy_tiles.size());
+    for(std::size_t i = 0; i < tiles.size(); i ++) {
+        EXPECT_EQ(lazy_tiles[i], tiles[i] - roi.tl());
+        EXPECT_EQ(tiles[i] & roi, tiles[i]);
+    }
+    EXPECT_LT(glx.back(), roi.br().x);
+    EXPECT_LT(gly.back(), roi.br().y);
+    // the region is cut out of the same rotated view, 
+    // the means only differ by the margin and background steps near the region border.
+    cv::Mat diff = cv::abs(stat_mats.mean - lazy_stat_mats.mean);
+    double max_diff;
+    cv::minMaxLoc(diff, nullptr, &max_diff);
+    EXPECT_LT(max_diff, 1.0);
+}
+TEST(single_image_general_gridding, result_cache_test) {
+    using FLOAT = float;
+    auto p = nucleona::test::data_dir() / "C018_2017_11_30_18_14_23" / "0-0-2.tiff";
+    cv::Mat img = cv::imread(p.string(), cv::IMREAD_ANYCOLOR | cv::IMREAD_ANYDEPTH);
+    auto path = boost::filesystem::temp_directory_path() 
+        / boost::filesystem::unique_path("result_cache_%%%%-%%%%.bin");
+    auto cache = std::make_shared<chipimgproc::rotation::ResultCache>(path);
+
+    // the first run detects the markers and the rotation and saves them
+    auto gridder = get_zion_gridder(2.68);
+    gridder.set_result_cache(cache, "zion 2.68");
+    auto [qc, tiled_mat, stat_mats, theta, bg_value] = gridder(img);
+    EXPECT_EQ(cache->size(), 1u);
+
+    // the second run takes them from the cache
+    auto cached_gridder = get_zion_gridder(2.68);
+    cached_gridder.set_result_cache(cache, "zion 2.68");
+    auto [cached_qc, cached_tiled_mat, cached_stat_mats, cached_theta, cached_bg_value] 
+        = cached_gridder(img);
+    EXPECT_EQ(cache->size(), 1u);
+
+    EXPECT_EQ(theta, cached_theta);
+    ASSERT_EQ(tiled_mat.rows(), cached_tiled_mat.rows());
+    ASSERT_EQ(tiled_mat.cols(), cached_tiled_mat.cols());
+    EXPECT_EQ(cv::countNonZero(stat_mats.mean   != cached_stat_mats.mean  ), 0);
+    EXPECT_EQ(cv::countNonZero(stat_mats.stddev != cached_stat_mats.stddev), 0);
+    EXPECT_EQ(cv::countNonZero(stat_mats.cv     != cached_stat_mats.cv    ), 0);
+    EXPECT_EQ(cv::countNonZero(stat_mats.num    != cached_stat_mats.num   ), 0);
+
+    cache.reset();
+    boost::filesystem::remove(path);
+    boost::filesystem::remove(path.string() + ".lock");
+}
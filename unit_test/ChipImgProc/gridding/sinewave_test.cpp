@@ -0,0 +1,42 @@
+#include <ChipImgProc/gridding.hpp>
+#include <Nucleona/app/cli/gtest.hpp>
+
+TEST(gridding, streaming_fit) {
+    // grid lines every 12.5 px along x and 9.25 px along y
+    cv::Mat_<float> img(300, 400);
+    for(int r = 0; r < img.rows; r ++) {
+        for(int c = 0; c < img.cols; c ++) {
+            img(r, c) = 1000 
+                + 300 * std::cos(2 * CV_PI * (c - 3.0) / 12.5) 
+                + 200 * std::cos(2 * CV_PI * (r - 1.0) / 9.25);
+        }
+    }
+    cv::Mat_<float> noise(img.size());
+    cv::randn(noise, 0, 30);
+    img += noise;
+
+    chipimgproc::Gridding<float> gridding;
+    auto ref_x = gridding.fit_sinewave<0, 14>(img, 30);
+    auto ref_y = gridding.fit_sinewave<1, 14>(img, 30);
+
+    gridding.set_streaming_fit(true);
+    // twice, the second calls reuse the padded buffers of a longer input
+    for(int k = 0; k < 2; k ++) {
+        auto x = gridding.fit_sinewave<0, 14>(img, 30);
+        auto y = gridding.fit_sinewave<1, 14>(img, 30);
+        ASSERT_EQ(x.size(), ref_x.size());
+        ASSERT_EQ(y.size(), ref_y.size());
+        for(std::size_t i = 0; i < x.size(); i ++) {
+            EXPECT_NEAR(x[i], ref_x[i], 0.05);
+        }
+        for(std::size_t i = 0; i < y.size(); i ++) {
+            EXPECT_NEAR(y[i], ref_y[i], 0.05);
+        }
+    }
+    // the whole gridding gives the same tiles
+    chipimgproc::Gridding<float> ref_gridding;
+    auto ref = ref_gridding(img, 30);
+    auto res = gridding(img, 30);
+    EXPECT_EQ(res.gl_x, ref.gl_x);
+    EXPECT_EQ(res.gl_y, ref.gl_y);
+}
@@ -0,0 +1,55 @@
+#include <ChipImgProc/hough_transform.hpp>
+#include <Nucleona/app/cli/gtest.hpp>
+TEST(hough_transform, private_accumulator_vote) {
+    cv::Mat_<std::uint8_t> img = cv::Mat_<std::uint8_t>::zeros(200, 300);
+    cv::line(img, cv::Point(10, 20), cv::Point(290, 40), cv::Scalar(255));
+    cv::line(img, cv::Point(50, 190), cv::Point(70, 5), cv::Scalar(255));
+    cv::Mat_<std::uint8_t> noise(img.size());
+    cv::randu(noise, 0, 255);
+    img.setTo(255, noise > 250);
+
+    chipimgproc::HoughTransform<float> hough(85, 95, 50);
+    hough.set_thread_num(1);
+    auto serial = hough.vote(img);
+    hough.set_thread_num(7);
+    auto para = hough.vote(img);
+    EXPECT_EQ(cv::countNonZero(serial != para), 0);
+
+    // exact: every theta row collects one vote per edge pixel
+    auto edge_num = cv::countNonZero(img > 127);
+    for(int t = 0; t < serial.rows; t ++) {
+        EXPECT_EQ(cv::sum(serial.row(t))[0], edge_num);
+    }
+
+    // a custom executor gives the same result
+    int calls = 0;
+    hough.set_executor([&calls](int n, const std::function<void(int, int, int)>& job) {
+        calls ++;
+        job(0, 0, n);
+    });
+    auto custom = hough.vote(img);
+    EXPECT_EQ(calls, 2);
+    EXPECT_EQ(cv::countNonZero(serial != custom), 0);
+}
+TEST(hough_transform, simd_vote) {
+    cv::Mat_<std::uint8_t> img = cv::Mat_<std::uint8_t>::zeros(211, 317);
+    cv::line(img, cv::Point(3, 30), cv::Point(310, 52), cv::Scalar(255));
+    cv::line(img, cv::Point(40, 200), cv::Point(61, 2), cv::Scalar(255));
+    cv::Mat_<std::uint8_t> noise(img.size());
+    cv::randu(noise, 0, 255);
+    img.setTo(255, noise > 250);
+
+    // the theta ranges below and above 90 degree have different rho ranges
+    for(auto&& [tmin, tmax] : {std::make_pair(85.0f, 95.0f), std::make_pair(0.0f, 180.0f)}) {
+        chipimgproc::HoughTransform<float> hough(tmin, tmax, 64);
+        hough.set_thread_num(3);
+        auto ref  = hough.vote(img);
+        auto simd = hough.vote_simd(img);
+        ASSERT_EQ(ref.size(), simd.size());
+        EXPECT_EQ(cv::countNonZero(ref != simd), 0);
+    }
+
+    // the scalar fallback of a double transform
+    chipimgproc::HoughTransform<double> hough(85, 95, 50);
+    EXPECT_EQ(cv::countNonZero(hough.vote(img) != hough.vote_simd(img)), 0);
+}
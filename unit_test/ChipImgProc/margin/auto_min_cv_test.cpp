@@ -0,0 +1,49 @@
+#include <ChipImgProc/margin/auto_min_cv.hpp>
+#include <Nucleona/app/cli/gtest.hpp>
+namespace {
+template<class AUTO_MIN_CV>
+void expect_same_min_cv(
+    const AUTO_MIN_CV& auto_min_cv, const cv::Mat& img, 
+    const std::vector<cv::Rect>& tiles, int ww, int wh
+) {
+    for(auto&& t : tiles) {
+        auto ref = auto_min_cv.find_min_cv(img, t, ww, wh);
+        auto res = auto_min_cv.find_min_cv_integral(img, t, ww, wh);
+        EXPECT_EQ(ref.win, res.win) << t;
+        EXPECT_EQ(ref.stat.mean, res.stat.mean);
+        EXPECT_EQ(ref.stat.stddev, res.stat.stddev);
+        EXPECT_EQ(ref.stat.cv, res.stat.cv);
+        EXPECT_EQ(ref.stat.num, res.stat.num);
+    }
+}
+}
+TEST(auto_min_cv, integral_search) {
+    cv::Mat_<std::uint16_t> img(60, 80);
+    cv::randu(img, 100, 4000);
+    // a flat region, its windows tie at zero CV
+    img(cv::Rect(40, 30, 12, 12)).setTo(1000);
+    chipimgproc::margin::AutoMinCV<float> auto_min_cv;
+    expect_same_min_cv(auto_min_cv, img, {
+        {0, 0, 20, 20}, {13, 7, 17, 11}, {36, 26, 20, 20}, {60, 40, 20, 20}
+    }, 6, 5);
+}
+TEST(auto_min_cv, integral_search_large_bright_image) {
+    // a whole-image squared sum integral of this image is far above 2^53
+    cv::Mat_<std::uint16_t> img(4096, 4096);
+    cv::randu(img, 60000, 65536);
+    std::vector<cv::Rect> tiles;
+    for(auto&& p : {cv::Point(8, 8), cv::Point(2048, 1024), cv::Point(4060, 4060), cv::Point(4000, 4070)}) {
+        cv::Rect t(p.x, p.y, 24, 20);
+        t &= cv::Rect(0, 0, img.cols, img.rows);
+        // low variance windows, differ by a single pixel
+        auto sub = img(t);
+        cv::randu(sub, 65533, 65536);
+        sub(cv::Rect(3, 4, 8, 8)).setTo(65535);
+        sub(cv::Rect(12, 6, 8, 8)).setTo(65535);
+        sub(cv::Rect(13, 7, 1, 1)).setTo(65534);
+        tiles.push_back(t);
+    }
+    chipimgproc::margin::AutoMinCV<float> auto_min_cv;
+    expect_same_min_cv(auto_min_cv, img, tiles, 8, 8);
+    expect_same_min_cv(auto_min_cv, img, tiles, 5, 7);
+}
@@ -0,0 +1,94 @@
+#include <ChipImgProc/margin.hpp>
+#include <Nucleona/app/cli/gtest.hpp>
+namespace {
+struct FakeGridRes {
+    std::uint32_t           feature_rows;
+    std::uint32_t           feature_cols;
+    std::vector<cv::Rect>   tiles;
+    std::vector<double>     gl_x;
+    std::vector<double>     gl_y;
+};
+chipimgproc::TiledMat<> make_tiled_mat(cv::Mat& img, int n, int tsize, int pad) {
+    FakeGridRes grid_res { 
+        static_cast<std::uint32_t>(n), static_cast<std::uint32_t>(n) 
+    };
+    for(int i = 0; i <= n; i ++) {
+        grid_res.gl_x.push_back(pad + i * tsize);
+        grid_res.gl_y.push_back(pad + i * tsize);
+    }
+    for(int r = 0; r < n; r ++) {
+        for(int c = 0; c < n; c ++) {
+            grid_res.tiles.emplace_back(pad + c * tsize, pad + r * tsize, tsize, tsize);
+        }
+    }
+    chipimgproc::marker::Layout mk_layout;
+    return chipimgproc::TiledMat<>::make_from_grid_res(grid_res, img, mk_layout);
+}
+}
+TEST(tile_dispatch, margin_methods) {
+    const int n = 23, tsize = 12, pad = 8;
+    cv::Mat_<std::uint16_t> img(n * tsize + 2 * pad, n * tsize + 2 * pad);
+    cv::randu(img, 100, 4000);
+    chipimgproc::Margin<float> margin;
+    std::vector<std::pair<std::string, float>> methods({
+        {"auto_min_cv", 0.6}, {"mid_seg", 0.6}, {"percentile", 0.8}, {"sig_est", 0.6}
+    });
+    for(auto&& [method, seg_rate] : methods) {
+        cv::Mat serial_img = img.clone();
+        cv::Mat para_img   = img.clone();
+        auto serial_tm = make_tiled_mat(serial_img, n, tsize, pad);
+        auto para_tm   = make_tiled_mat(para_img,   n, tsize, pad);
+        chipimgproc::margin::Param<> serial_param {
+            seg_rate, 0.17, &serial_tm, true, nullptr
+        };
+        chipimgproc::margin::Param<> para_param {
+            seg_rate, 0.17, &para_tm, true, nullptr, 4
+        };
+        auto serial_res = margin(method, serial_param);
+        auto para_res   = margin(method, para_param);
+        EXPECT_EQ(cv::countNonZero(serial_res.stat_mats.mean   != para_res.stat_mats.mean  ), 0) << method;
+        // sig_est may produce NaN stddev, compare them as equal
+        cv::Mat serial_sd = serial_res.stat_mats.stddev.clone();
+        cv::Mat para_sd   = para_res.stat_mats.stddev.clone();
+        cv::patchNaNs(serial_sd, -1);
+        cv::patchNaNs(para_sd, -1);
+        EXPECT_EQ(cv::countNonZero(serial_sd != para_sd), 0) << method;
+        EXPECT_EQ(serial_tm.get_tiles(), para_tm.get_tiles()) << method;
+    }
+}
+TEST(tile_dispatch, sig_est_shared_geometry) {
+    const int n = 17, tsize = 11, pad = 8;
+    cv::Mat_<std::uint16_t> img(n * tsize + 2 * pad, n * tsize + 2 * pad);
+    cv::randu(img, 100, 4000);
+    cv::Mat img0 = img.clone();
+    cv::Mat img1 = img.clone();
+    auto tm0 = make_tiled_mat(img0, n, tsize, pad);
+    auto tm1 = make_tiled_mat(img1, n, tsize, pad);
+
+    chipimgproc::margin::SigEst<float> shared_sig_est;
+    chipimgproc::margin::SigEst<float> private_sig_est;
+    auto private_geometry = std::make_shared<chipimgproc::margin::SigEstGeometry>();
+    private_sig_est.set_geometry(private_geometry);
+    private_sig_est.set_thread_num(3);
+    auto res0 = shared_sig_est(tm0, 0.6);
+    auto res1 = private_sig_est(tm1, 0.6);
+    EXPECT_EQ(cv::countNonZero(res0.mean != res1.mean), 0);
+    EXPECT_EQ(cv::countNonZero(res0.bg   != res1.bg  ), 0);
+    EXPECT_NE(chipimgproc::margin::SigEstGeometry::shared()->snapshot()->find(tsize, tsize), nullptr);
+    EXPECT_NE(private_geometry->snapshot()->find(tsize, tsize), nullptr);
+    EXPECT_EQ(private_geometry->snapshot()->find(tsize + 1, tsize), nullptr);
+
+    // the large tile sizes are keyed in the map, the flat table stays bounded
+    using Table = chipimgproc::margin::SigEstGeometry::Table;
+    private_geometry->prepare(std::vector<cv::Rect>{
+        {0, 0, 300, 200}, {0, 0, tsize, Table::flat_max}
+    });
+    auto table = private_geometry->snapshot();
+    EXPECT_NE(table->find(300, 200), nullptr);
+    EXPECT_NE(table->find(tsize, Table::flat_max), nullptr);
+    EXPECT_NE(table->find(tsize, tsize), nullptr);
+    EXPECT_EQ(table->find(200, 300), nullptr);
+    EXPECT_EQ(table->at(300, 200).dx, 38);
+    EXPECT_LE(table->index.size(), std::size_t(Table::flat_max * Table::flat_max));
+    EXPECT_EQ(table->large.size(), 2u);
+}
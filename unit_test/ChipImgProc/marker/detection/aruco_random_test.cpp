@@ -3,6 +3,7 @@
 #include <Nucleona/test/data_dir.hpp>
 #include <ChipImgProc/marker/detection/aruco_random.hpp>
 #include <ChipImgProc/marker/view.hpp>
+#include <numeric>
 #include <string>
 
 TEST(aruco_reg_mat, basic_test) {
@@ -140,4 +141,119 @@ TEST(aruco_reg_mat, basic_test) {
         // For image gridding process, it should detect 2 marker in deferent column and row at least.
     }
 }
-/// [usage]
\ No newline at end of file
+/// [usage]
+TEST(aruco_reg_mat, parallel_refinement) {
+    auto db_path = nucleona::test::data_dir() / "aruco_db.json";
+    auto img_path = nucleona::test::data_dir() / "aruco_test_img-0.tiff";
+    cv::Mat_<std::uint8_t> img = cv::imread(
+        img_path.string(), cv::IMREAD_ANYCOLOR | cv::IMREAD_ANYDEPTH
+    );
+    std::vector<std::int32_t> aruco_ids(53);
+    std::iota(aruco_ids.begin(), aruco_ids.end(), 0);
+    auto [templ, mask] = chipimgproc::aruco::create_location_marker(
+        50, 40, 3, 5, 2.68
+    );
+    auto detector(chipimgproc::marker::detection::make_aruco_random(
+        db_path.string(), "DICT_6X6_250",
+        templ, mask, 30 * 2.68, 2, 255.0, 9, 50 * 2.68, 0.75
+    ));
+    auto serial = detector(img, aruco_ids);
+
+    detector.set_thread_num(4);
+    auto parallel = detector(img, aruco_ids);
+    EXPECT_EQ(parallel, serial);
+
+    // a shared executor gives the same results
+    detector.set_executor(chipimgproc::algo::make_block_executor(3));
+    EXPECT_EQ(detector(img, aruco_ids), serial);
+}
+TEST(aruco_reg_mat, direct_decode) {
+    auto db_path = nucleona::test::data_dir() / "aruco_db.json";
+    auto [templ, mask] = chipimgproc::aruco::create_location_marker(
+        50, 40, 3, 5, 2.68
+    );
+    auto detector(chipimgproc::marker::detection::make_aruco_random(
+        db_path.string(), "DICT_6X6_250",
+        templ, mask, 30 * 2.68, 2, 255.0, 9, 50 * 2.68, 0.75
+    ));
+    std::vector<std::int32_t> aruco_ids(53);
+    std::iota(aruco_ids.begin(), aruco_ids.end(), 0);
+    for(auto&& name : {"aruco_test_img-0.tiff", "aruco_test_img-1.tiff"}) {
+        cv::Mat_<std::uint8_t> img = cv::imread(
+            (nucleona::test::data_dir() / name).string(), 
+            cv::IMREAD_ANYCOLOR | cv::IMREAD_ANYDEPTH
+        );
+        detector.set_direct_decode(false);
+        auto expected = detector(img, aruco_ids);
+        detector.set_direct_decode(true);
+        auto results = detector(img, aruco_ids);
+        ASSERT_EQ(results.size(), expected.size());
+        for(std::size_t i = 0; i < results.size(); i ++) {
+            EXPECT_EQ(std::get<0>(results[i]), std::get<0>(expected[i]));
+        }
+
+        // the same bits on the marker patches of the image, for sub-pixel shifted 
+        // and rotated anchors, and with the windows clipped by the patch border
+        chipimgproc::algo::ImagePyramid pyramid(
+            img, 2, 255.0, chipimgproc::algo::ImagePyramid::clip_to_mean
+        );
+        const cv::Mat_<std::uint8_t>& image = pyramid.level(0);
+        auto& templ_anchors = detector.anchors();
+        auto center_anchor = templ_anchors.back();
+        int compared = 0;
+        for(auto&& [id, score, center] : expected) {
+            for(int crop : {0, 3}) {
+                cv::Rect roi(
+                    std::floor(center.x - center_anchor[0]) + crop,
+                    std::floor(center.y - center_anchor[1]) + crop,
+                    templ.cols - 2 * crop, templ.rows - 2 * crop
+                );
+                if((roi & cv::Rect(0, 0, image.cols, image.rows)) != roi) continue;
+                cv::Mat patch = image(roi);
+                for(double angle : {-1.0, 0.0, 1.0}) {
+                    for(float shift : {0.0f, 0.25f, 0.5f, 0.75f}) {
+                        auto wmat = cv::getRotationMatrix2D(
+                            cv::Point2f(center_anchor[0], center_anchor[1]), angle, 1.0
+                        );
+                        wmat.at<double>(0, 2) += center.x - center_anchor[0] - roi.x + shift;
+                        wmat.at<double>(1, 2) += center.y - center_anchor[1] - roi.y + shift;
+                        std::vector<cv::Vec2f> anchors;
+                        cv::transform(templ_anchors, anchors, wmat);
+                        detector.set_direct_decode(false);
+                        auto binary = detector.decode(patch, anchors);
+                        detector.set_direct_decode(true);
+                        EXPECT_EQ(detector.decode(patch, anchors), binary)
+                            << name << " marker " << id << " crop " << crop 
+                            << " angle " << angle << " shift " << shift;
+                        compared ++;
+                    }
+                }
+            }
+        }
+        EXPECT_GT(compared, 0);
+    }
+}
+TEST(aruco_reg_mat, shared_pyramid) {
+    auto db_path = nucleona::test::data_dir() / "aruco_db.json";
+    auto img_path = nucleona::test::data_dir() / "aruco_test_img-0.tiff";
+    cv::Mat_<std::uint8_t> img = cv::imread(
+        img_path.string(), cv::IMREAD_ANYCOLOR | cv::IMREAD_ANYDEPTH
+    );
+    std::vector<std::int32_t> aruco_ids(53);
+    std::iota(aruco_ids.begin(), aruco_ids.end(), 0);
+    auto [templ, mask] = chipimgproc::aruco::create_location_marker(
+        50, 40, 3, 5, 2.68
+    );
+    auto detector(chipimgproc::marker::detection::make_aruco_random(
+        db_path.string(), "DICT_6X6_250",
+        templ, mask, 30 * 2.68, 2, 255.0, 9, 50 * 2.68, 0.75
+    ));
+    // a deeper pyramid is shared with a coarser detector
+    chipimgproc::algo::ImagePyramid pyramid(
+        img, 3, 255.0, chipimgproc::algo::ImagePyramid::clip_to_mean
+    );
+    EXPECT_EQ(detector(pyramid, aruco_ids), detector(img, aruco_ids));
+
+    chipimgproc::algo::ImagePyramid shallow(img, 1, 255.0);
+    EXPECT_THROW(detector(shallow, aruco_ids), std::invalid_argument);
+}
@@ -81,4 +81,24 @@ TEST(estimate_bias_test, simultaion_shift) {
     std::cout << bias << std::endl;
     EXPECT_LT(std::abs(bias.x + 50), 3);
     EXPECT_LT(std::abs(bias.y + 60), 3);
+
+    // the FFT matching only differs by float rounding
+    chipimgproc::marker::detection::EstimateBias fft_estimate_bias;
+    fft_estimate_bias.set_fft_match(true);
+    auto [fft_bias, fft_score] = fft_estimate_bias(
+            green_img, green_templ, green_mask, aruco_mk_pos, 0.42558601126675694, false,
+            tmp, false, cv::Size2d(0.0, 0.0)
+        );
+    EXPECT_NEAR(fft_bias.x, bias.x, 1e-3);
+    EXPECT_NEAR(fft_bias.y, bias.y, 1e-3);
+    EXPECT_NEAR(fft_score, score, 1e-4);
+    // the next FOV reuses the matcher of the template and angle
+    EXPECT_EQ(fft_estimate_bias.fft_cache()->size(), 1u);
+    auto [next_bias, next_score] = fft_estimate_bias(
+            green_img, green_templ, green_mask, aruco_mk_pos, 0.42558601126675694, false,
+            tmp, false, cv::Size2d(0.0, 0.0)
+        );
+    EXPECT_EQ(fft_estimate_bias.fft_cache()->size(), 1u);
+    EXPECT_EQ(next_bias, fft_bias);
+    EXPECT_EQ(next_score, fft_score);
 }
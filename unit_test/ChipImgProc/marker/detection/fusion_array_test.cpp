@@ -0,0 +1,114 @@
+#include <ChipImgProc/marker/detection/fusion_array.hpp>
+#include <Nucleona/app/cli/gtest.hpp>
+#include <Nucleona/test/data_dir.hpp>
+#include "../../make_layout.hpp"
+
+namespace cmd = chipimgproc::marker::detection;
+
+namespace {
+using Result = std::tuple<cv::Point, double, cv::Point2d>;
+/*
+ *  The FusionArray search before the shared pyramid, each marker region is
+ *  cut from the full scale image and downsampled separately.
+ */
+std::vector<Result> per_region_pyr_down(
+    const cmd::cvMat8&                  image,
+    const cmd::cvMat8&                  templ,
+    const cmd::cvMat8&                  mask,
+    int                                 pyramid_level,
+    const std::vector<cmd::MKRegion>&   marker_regions
+) {
+    const int s = 1 << pyramid_level;
+    auto dsize_w = templ.cols;
+    auto dsize_h = templ.rows;
+    for(auto i = pyramid_level; i > 0; i --) {
+        dsize_w = (dsize_w + 1) / 2;
+        dsize_h = (dsize_h + 1) / 2;
+    }
+    cmd::cvMat8 stempl, smask;
+    cv::resize(templ, stempl, cv::Size(dsize_w, dsize_h), 0, 0, cv::INTER_AREA);
+    cv::resize(mask,  smask,  cv::Size(dsize_w, dsize_h), 0, 0, cv::INTER_NEAREST);
+
+    std::vector<Result> results;
+    for(auto& mk_r : marker_regions) {
+        cmd::cvMat8 starget = image(mk_r).clone();
+        for(auto i = 0; i < pyramid_level; ++i)
+            cv::pyrDown(starget, starget);
+        starget = starget(cv::Rect(1, 1, starget.cols - 2, starget.rows - 2));
+        auto match1 = chipimgproc::match_template(starget, stempl, cv::TM_CCORR_NORMED, smask);
+        cv::Point loc;
+        cv::minMaxLoc(match1, nullptr, nullptr, nullptr, &loc);
+
+        double map_buffer_r = 2.0;
+        auto w = templ.cols + (2 * s);
+        auto h = templ.rows + (2 * s);
+        auto x = loc.x * s - std::round((map_buffer_r / 2 - 0.5) * w);
+        auto y = loc.y * s - std::round((map_buffer_r / 2 - 0.5) * h);
+        cmd::cvMat8 patch;
+        if(
+            mk_r.x + x < 0 || mk_r.y + y < 0 ||
+            mk_r.x + x + map_buffer_r * w >= image.cols ||
+            mk_r.y + y + map_buffer_r * h >= image.rows
+        ) {
+            cv::Point2d center(mk_r.x + x + (map_buffer_r * w - 1) / 2.0, mk_r.y + y + (map_buffer_r * h - 1) / 2.0);
+            cv::getRectSubPix(image, cv::Size2d(map_buffer_r * w, map_buffer_r * h), center, patch);
+        } else {
+            patch = image(cv::Rect(mk_r.x + x, mk_r.y + y, map_buffer_r * w, map_buffer_r * h));
+        }
+        auto match2 = chipimgproc::match_template(patch, templ, cv::TM_CCORR_NORMED, mask);
+        double score;
+        cv::Point dxy;
+        cv::minMaxLoc(match2, nullptr, &score, nullptr, &dxy);
+        cv::Point2d center(
+            mk_r.x + x + dxy.x + ((templ.cols - 1) / 2.0),
+            mk_r.y + y + dxy.y + ((templ.rows - 1) / 2.0)
+        );
+        results.emplace_back(cv::Point(mk_r.x_i, mk_r.y_i), score, center);
+    }
+    return results;
+}
+}
+
+TEST(fusion_array, shared_pyramid) {
+    const int pyramid_level = 2;
+    const double theor_max_val = 16383;
+    auto mk_layout = make_banff_layout("banff_rc/pat_CY3.tsv", 2.68);
+    auto& mk_des = mk_layout.get_marker_des(0, 0);
+    cmd::cvMat8 templ = mk_des.get_std_mk(chipimgproc::MatUnit::PX);
+    cmd::cvMat8 mask  = mk_des.get_std_mk_mask(chipimgproc::MatUnit::PX);
+    for(auto&& name : {"0-0-2.tiff", "0-1-2.tiff", "1-1-2.tiff"}) {
+        cv::Mat img = cv::imread(
+            (nucleona::test::data_dir() / "banff_test" / name).string(),
+            cv::IMREAD_ANYCOLOR | cv::IMREAD_ANYDEPTH
+        );
+        auto detector = cmd::make_fusion_array(
+            templ, mask, pyramid_level, theor_max_val, img, mk_layout
+        );
+        detector.set_pb_img_preprocessor();
+
+        // the image version builds the same pyramid as a shared one
+        chipimgproc::algo::ImagePyramid pyramid(
+            img, pyramid_level, theor_max_val,
+            [](const cmd::cvMat8& mat) -> cmd::cvMat8 { return chipimgproc::norm_u8(mat); }
+        );
+        auto results = detector(img);
+        EXPECT_EQ(detector(pyramid), results);
+
+        // the regions cut from the shared level only move the coarse search
+        // by the region alignment, the markers stay within one pixel
+        auto regions = detector.generate_raw_marker_regions(
+            img.cols, img.rows, mk_layout, chipimgproc::MatUnit::PX, std::cout
+        );
+        auto expected = per_region_pyr_down(
+            pyramid.level(0), templ, mask, pyramid_level, regions
+        );
+        ASSERT_EQ(results.size(), expected.size());
+        for(std::size_t i = 0; i < results.size(); i ++) {
+            auto& [id, score, center] = results[i];
+            auto& [exp_id, exp_score, exp_center] = expected[i];
+            EXPECT_EQ(id, exp_id);
+            EXPECT_LE(std::abs(center.x - exp_center.x), 1.0) << name << " marker " << id;
+            EXPECT_LE(std::abs(center.y - exp_center.y), 1.0) << name << " marker " << id;
+        }
+    }
+}
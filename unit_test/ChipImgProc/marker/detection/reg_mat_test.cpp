@@ -46,6 +46,35 @@ TEST(reg_mat_layout, operator_call_test) {
     }
 }
 /// [usage]
+TEST(reg_mat_layout, fft_match) {
+    auto img_path = 
+        nucleona::test::data_dir() / "C018_2017_11_30_18_14_23" / "0-0-2.tiff";
+    cv::Mat_<std::uint16_t> img = cv::imread(
+        img_path.string(), cv::IMREAD_ANYCOLOR | cv::IMREAD_ANYDEPTH
+    );
+    auto mk_layout = make_zion_layout(2.68);
+    chipimgproc::marker::detection::RegMat reg_mat;
+    auto mk_regs = reg_mat(img, mk_layout, chipimgproc::MatUnit::PX);
+    reg_mat.set_fft_match(true);
+    auto fft_mk_regs = reg_mat(img, mk_layout, chipimgproc::MatUnit::PX);
+    ASSERT_EQ(mk_regs.size(), fft_mk_regs.size());
+    for(std::size_t i = 0; i < mk_regs.size(); i ++) {
+        // the top 20 scores averaged, a float rounding tie can swap one point
+        EXPECT_LE(std::abs(mk_regs[i].x - fft_mk_regs[i].x), 1);
+        EXPECT_LE(std::abs(mk_regs[i].y - fft_mk_regs[i].y), 1);
+        EXPECT_NEAR(mk_regs[i].score, fft_mk_regs[i].score, 1e-4);
+    }
+    // the next FOV reuses the matchers of the candidate markers
+    auto matcher_num = reg_mat.fft_cache()->size();
+    EXPECT_GT(matcher_num, 0u);
+    auto next_mk_regs = reg_mat(img, mk_layout, chipimgproc::MatUnit::PX);
+    EXPECT_EQ(reg_mat.fft_cache()->size(), matcher_num);
+    ASSERT_EQ(next_mk_regs.size(), fft_mk_regs.size());
+    for(std::size_t i = 0; i < fft_mk_regs.size(); i ++) {
+        EXPECT_EQ(static_cast<const cv::Rect&>(next_mk_regs[i]), static_cast<const cv::Rect&>(fft_mk_regs[i]));
+        EXPECT_EQ(next_mk_regs[i].score, fft_mk_regs[i].score);
+    }
+}
 
 
 TEST(reg_mat_layout, hard_case) {
@@ -0,0 +1,57 @@
+#include <ChipImgProc/rotation/iteration_cali.hpp>
+#include <ChipImgProc/rotation/calibrate.hpp>
+#include <Nucleona/app/cli/gtest.hpp>
+
+// The angle of the longest line, the correction angle of Calibrate.
+float longest_line_angle(const cv::Mat& img) {
+    double max_val;
+    cv::minMaxLoc(img, nullptr, &max_val);
+    cv::Mat_<std::uint8_t> bin = img > max_val * 0.5;
+    cv::Mat labels, stats, centroids;
+    auto n = cv::connectedComponentsWithStats(bin, labels, stats, centroids);
+    int longest = 1;
+    for(int i = 2; i < n; i ++) {
+        if(stats.at<int>(i, cv::CC_STAT_AREA) > stats.at<int>(longest, cv::CC_STAT_AREA)) {
+            longest = i;
+        }
+    }
+    std::vector<cv::Point> points;
+    cv::findNonZero(labels == longest, points);
+    cv::Vec4f line;
+    cv::fitLine(points, line, cv::DIST_L2, 0, 0.01, 0.01);
+    if(line[0] < 0) {
+        line[0] = -line[0];
+        line[1] = -line[1];
+    }
+    return std::atan2(line[1], line[0]) * 180.0 / CV_PI;
+}
+
+TEST(iteration_cali, pyramid) {
+    cv::Mat_<std::uint8_t> img = cv::Mat_<std::uint8_t>::zeros(900, 1200);
+    for(int y = 20; y < img.rows; y += 40) {
+        cv::line(img, cv::Point(0, y), cv::Point(img.cols - 1, y), cv::Scalar(255), 3);
+    }
+    const float truth = 1.5;
+    chipimgproc::rotation::Calibrate calibrate;
+    calibrate(img, truth);
+
+    auto cali = chipimgproc::rotation::make_iteration_cali(
+        [](const cv::Mat& m) { return longest_line_angle(m); },
+        calibrate
+    );
+    auto full = cali(img);
+    EXPECT_NEAR(full, -truth, 0.1);
+
+    cali.set_pyramid(2, 256, 2);
+    auto pyramid = cali(img);
+    EXPECT_NEAR(pyramid, -truth, 0.1);
+    EXPECT_NEAR(pyramid, full, 0.1);
+
+    // calibrate() rotates the image once with the estimated angle
+    cv::Mat rotated = img.clone();
+    auto theta = cali.calibrate(rotated);
+    EXPECT_FLOAT_EQ(theta, pyramid);
+    cv::Mat expect = img.clone();
+    calibrate(expect, theta);
+    EXPECT_EQ(cv::countNonZero(rotated != expect), 0);
+}
@@ -0,0 +1,94 @@
+#include <ChipImgProc/rotation/result_cache.hpp>
+#include <Nucleona/app/cli/gtest.hpp>
+#include <thread>
+
+namespace cr = chipimgproc::rotation;
+
+cr::ResultCache::Entry make_entry(double theta) {
+    cr::ResultCache::Entry entry;
+    entry.theta     = theta;
+    entry.um2px_r   = 2.4145;
+    entry.warp_mat  = cv::getRotationMatrix2D(cv::Point2f(100, 80), theta, 1.0);
+    for(int i = 0; i < 3; i ++) {
+        chipimgproc::marker::detection::MKRegion mk;
+        mk.x = 10 * i; mk.y = 20 * i; mk.width = 30; mk.height = 40;
+        mk.x_i = i; mk.y_i = 0; mk.score = 0.5 * i;
+        entry.markers.push_back(mk);
+    }
+    return entry;
+}
+
+TEST(result_cache, save_and_find) {
+    auto path = boost::filesystem::temp_directory_path() 
+        / boost::filesystem::unique_path("result_cache_%%%%-%%%%.bin");
+    cv::Mat_<std::uint16_t> img(60, 70);
+    cv::randu(img, 0, 65535);
+    auto key = cr::ResultCache::make_key(img, "zion 2.68");
+    {
+        cr::ResultCache cache(path);
+        EXPECT_FALSE(cache.find(key));
+        cache.save(key, make_entry(0.3));
+        auto res = cache.find(key);
+        ASSERT_TRUE(res);
+        auto expect = make_entry(0.3);
+        EXPECT_DOUBLE_EQ(res->theta, expect.theta);
+        EXPECT_DOUBLE_EQ(res->um2px_r, expect.um2px_r);
+        EXPECT_EQ(cv::countNonZero(res->warp_mat != expect.warp_mat), 0);
+        ASSERT_EQ(res->markers.size(), expect.markers.size());
+        for(std::size_t i = 0; i < expect.markers.size(); i ++) {
+            EXPECT_EQ(static_cast<const cv::Rect&>(res->markers[i]), static_cast<const cv::Rect&>(expect.markers[i]));
+            EXPECT_EQ(res->markers[i].x_i, expect.markers[i].x_i);
+            EXPECT_DOUBLE_EQ(res->markers[i].score, expect.markers[i].score);
+        }
+        // other parameters or image content are other keys
+        EXPECT_FALSE(cache.find(cr::ResultCache::make_key(img, "zion 2.41")));
+        img(0, 0) ^= 1;
+        EXPECT_FALSE(cache.find(cr::ResultCache::make_key(img, "zion 2.68")));
+        // the later record replaces the earlier one
+        cache.save(key, make_entry(-0.1));
+        EXPECT_DOUBLE_EQ(cache.find(key)->theta, -0.1);
+    }
+    // a torn record at the tail is ignored and truncated by the next save
+    {
+        std::ofstream fout(path.string(), std::ios::binary | std::ios::app);
+        fout.write("RCRC\x10", 5);
+    }
+    {
+        cr::ResultCache cache(path);
+        EXPECT_DOUBLE_EQ(cache.find(key)->theta, -0.1);
+        auto key2 = key;
+        key2.param ++;
+        cache.save(key2, make_entry(0.7));
+        EXPECT_DOUBLE_EQ(cache.find(key2)->theta, 0.7);
+        EXPECT_EQ(cache.size(), 2u);
+    }
+    // another object on the same file sees the records of the others
+    {
+        cr::ResultCache writer(path);
+        cr::ResultCache reader(path);
+        EXPECT_DOUBLE_EQ(reader.find(key)->theta, -0.1);
+        cr::ResultCache::Key key3{1, 2};
+        std::vector<std::thread> threads;
+        for(int t = 0; t < 4; t ++) {
+            threads.emplace_back([&writer, &reader, t]() {
+                for(int i = 0; i < 20; i ++) {
+                    cr::ResultCache::Key k{100u + t, std::uint64_t(i)};
+                    writer.save(k, make_entry(i));
+                    auto res = reader.find(k);
+                    ASSERT_TRUE(res);
+                    EXPECT_DOUBLE_EQ(res->theta, i);
+                }
+            });
+        }
+        for(auto& t : threads) t.join();
+        // a missing key refreshes the index of the reader
+        EXPECT_FALSE(reader.find(key3));
+        EXPECT_EQ(writer.size(), 82u);
+        EXPECT_EQ(reader.size(), 82u);
+        // the records saved by the reader are seen by the writer too
+        reader.save(key3, make_entry(1.5));
+        EXPECT_DOUBLE_EQ(writer.find(key3)->theta, 1.5);
+    }
+    boost::filesystem::remove(path);
+    boost::filesystem::remove(path.string() + ".lock");
+}
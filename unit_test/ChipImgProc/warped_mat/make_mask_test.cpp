@@ -0,0 +1,185 @@
+#include <ChipImgProc/warped_mat/make_mask.hpp>
+#include <Nucleona/app/cli/gtest.hpp>
+#include <thread>
+using namespace chipimgproc;
+
+namespace {
+/*
+ *  The probe geometry of the rescaled banff chip (warped_mat_test),
+ *  on a 60 x 60 probe grid.
+ */
+struct MaskGeom {
+    cv::Point   origin  {0, 0};
+    int         clw     {8};
+    int         clh     {8};
+    int         clwd    {10};
+    int         clhd    {10};
+    int         clwn    {60};
+    int         clhn    {60};
+    double      conv_w  {8 * 0.6};
+    double      conv_h  {8 * 0.6};
+    double      um2px_r {2.4145 / 2};
+    int w() const { return clwd * clwn; }
+    int h() const { return clhd * clhn; }
+    cv::Mat warp() const {
+        auto rot = cv::getRotationMatrix2D(cv::Point2f(0, 0), 0.3, um2px_r);
+        rot.at<double>(0, 2) = 20.3;
+        rot.at<double>(1, 2) = 15.7;
+        return rot;
+    }
+    cv::Size dsize() const {
+        return cv::Size(std::ceil(w() * um2px_r) + 40, std::ceil(h() * um2px_r) + 40);
+    }
+};
+cv::Mat make_mask(const warped_mat::MakeMask& make, const MaskGeom& g) {
+    return make(
+        g.origin, g.clw, g.clh, g.clwd, g.clhd, g.w(), g.h(),
+        g.conv_w, g.conv_h, g.um2px_r, g.clwn, g.clhn, g.warp(), g.dsize()
+    );
+}
+/*
+ *  The mask generation before the compiled graph cache, a fresh
+ *  warpAffine -> filter2D -> subC -> convertTo graph applied on
+ *  each of the 4 interleaved partial masks.
+ */
+cv::Mat baseline_mask(const MaskGeom& g) {
+    int clwsp = (g.clwd - g.clw) / 2;
+    int clhsp = (g.clhd - g.clh) / 2;
+    int conv_w_px = std::round(g.conv_w * g.um2px_r);
+    int conv_h_px = std::round(g.conv_h * g.um2px_r);
+    cv::Mat kern(conv_h_px, conv_w_px, CV_64F, cv::Scalar(1.0 / (conv_h_px * conv_w_px)));
+    cv::GMat g_in;
+    cv::GMat g_tmp1 = cv::gapi::warpAffine(g_in, g.warp(), g.dsize());
+    cv::GMat g_tmp2 = cv::gapi::filter2D(g_tmp1, CV_64F, kern);
+    cv::GMat g_tmp3 = cv::gapi::subC(g_tmp2, cv::GScalar(254.49));
+    cv::GMat g_out  = cv::gapi::convertTo(g_tmp3, CV_8U);
+    cv::GComputation computation(cv::GIn(g_in), cv::GOut(g_out));
+
+    cv::Mat res = cv::Mat::zeros(g.dsize(), CV_8U);
+    for(int i = 0; i < 2; i ++) {
+        for(int j = 0; j < 2; j ++) {
+            cv::Mat mat = cv::Mat::zeros(g.h(), g.w(), CV_8U);
+            for(int y = g.origin.y + g.clhd * i; y < g.h(); y += g.clhd * 2) {
+                for(int x = g.origin.x + g.clwd * j; x < g.w(); x += g.clwd * 2) {
+                    mat(cv::Rect(x + clwsp, y + clhsp, g.clw, g.clh)).setTo(255);
+                }
+            }
+            cv::Mat warp_mask(g.dsize(), CV_8U);
+            computation.apply(
+                cv::gin(mat), cv::gout(warp_mask),
+                cv::compile_args(cv::gapi::combine(
+                    cv::gapi::core::cpu::kernels(),
+                    cv::gapi::imgproc::cpu::kernels()
+                ))
+            );
+            res += warp_mask;
+        }
+    }
+    return res >= 1;
+}
+}
+
+TEST(make_mask_test, compiled_graph_same_as_baseline) {
+    MaskGeom geom;
+    auto ref = baseline_mask(geom);
+    ASSERT_GT(cv::countNonZero(ref), 0);
+
+    warped_mat::MakeMask make;
+    make.set_backend(warped_mat::MaskBackend::cpu);
+    EXPECT_EQ(cv::norm(make_mask(make, geom), ref, cv::NORM_INF), 0);
+}
+
+TEST(make_mask_test, fused_partial_mask) {
+    warped_mat::MakeMask make;
+    make.set_backend(warped_mat::MaskBackend::cpu);
+    make.set_fuse_partial_mask(true);
+
+    // the probe gap is at least one pixel, the single fused pass is used
+    MaskGeom geom;
+    EXPECT_EQ(cv::norm(make_mask(make, geom), baseline_mask(geom), cv::NORM_INF), 0);
+
+    // no probe gap, it falls back to the 4 interleaved passes
+    MaskGeom no_gap;
+    no_gap.clw = no_gap.clwd;
+    no_gap.clh = no_gap.clhd;
+    EXPECT_EQ(cv::norm(make_mask(make, no_gap), baseline_mask(no_gap), cv::NORM_INF), 0);
+}
+
+TEST(compiled_mask_test, cache_hit_miss) {
+    MaskGeom geom;
+    warped_mat::MakeMask make;
+    make.set_backend(warped_mat::MaskBackend::cpu);
+    auto& cache = *make.compiled_mask();
+
+    // the 4 partial passes compile the graph once
+    auto first = make_mask(make, geom);
+    EXPECT_EQ(cache.size(),   1u);
+    EXPECT_EQ(cache.misses(), 1u);
+    EXPECT_EQ(cache.hits(),   3u);
+
+    // the next FOV with the same geometry and a copy of the object reuse it
+    auto copy = make;
+    auto second = make_mask(copy, geom);
+    EXPECT_EQ(cv::norm(first, second, cv::NORM_INF), 0);
+    EXPECT_EQ(cache.size(),   1u);
+    EXPECT_EQ(cache.misses(), 1u);
+    EXPECT_EQ(cache.hits(),   7u);
+
+    // another kernel size is another graph
+    geom.conv_w = geom.clw * 0.4;
+    make_mask(make, geom);
+    EXPECT_EQ(cache.size(),   2u);
+    EXPECT_EQ(cache.misses(), 2u);
+
+    cache.clear();
+    EXPECT_EQ(cache.size(),   0u);
+    EXPECT_EQ(cache.hits(),   0u);
+}
+
+TEST(compiled_mask_test, concurrent_callers) {
+    MaskGeom geom;
+    warped_mat::MakeMask make;
+    make.set_backend(warped_mat::MaskBackend::cpu);
+    auto ref = make_mask(make, geom);
+
+    const int thread_num = 4;
+    std::vector<cv::Mat> res(thread_num);
+    std::vector<std::thread> workers;
+    for(int t = 0; t < thread_num; t ++) {
+        workers.emplace_back([&, t](){
+            res[t] = make_mask(make, geom);
+        });
+    }
+    for(auto&& w : workers) w.join();
+    for(auto&& r : res) {
+        EXPECT_EQ(cv::norm(r, ref, cv::NORM_INF), 0);
+    }
+    // one key, at most one compiled instance per concurrent caller
+    auto& cache = *make.compiled_mask();
+    EXPECT_EQ(cache.size(), 1u);
+    EXPECT_LE(cache.misses(), 1u + thread_num);
+    EXPECT_EQ(cache.hits() + cache.misses(), 4u * (1 + thread_num));
+}
+
+TEST(make_mask_test, strip_backend_same_as_gapi_backends) {
+    MaskGeom geom;
+    warped_mat::MakeMask make;
+    make.set_backend(warped_mat::MaskBackend::cpu);
+    auto cpu_mask = make_mask(make, geom);
+    make.set_backend(warped_mat::MaskBackend::gpu);
+    auto gpu_mask = make_mask(make, geom);
+    ASSERT_GT(cv::countNonZero(cpu_mask), 0);
+    EXPECT_EQ(cv::norm(cpu_mask, gpu_mask, cv::NORM_INF), 0);
+
+    // the strip borders must not change the result, whatever the strip size
+    for(int strip_rows : {1, 7, 64, geom.dsize().height}) {
+        make.set_backend(warped_mat::MaskBackend::strip, strip_rows);
+        EXPECT_EQ(cv::norm(make_mask(make, geom), cpu_mask, cv::NORM_INF), 0)
+            << "strip rows: " << strip_rows;
+    }
+
+    // the fused partial mask goes through the same strip pipeline
+    make.set_fuse_partial_mask(true);
+    make.set_backend(warped_mat::MaskBackend::strip, 64);
+    EXPECT_EQ(cv::norm(make_mask(make, geom), cpu_mask, cv::NORM_INF), 0);
+}
@@ -1,4 +1,5 @@
 #include <ChipImgProc/warped_mat.hpp>
+#include <cfloat>
 #include <Nucleona/app/cli/gtest.hpp>
 #include <Nucleona/test/data_dir.hpp>
 #include <ChipImgProc/marker/detection/aruco_random.hpp>
@@ -8,27 +9,35 @@
 #include <ChipImgProc/warped_mat/estimate_transform_mat.hpp>
 using namespace chipimgproc;
 
-TEST(warped_mat_test, basic_test) {
-    using namespace std::string_literals;
-    const double um2px_r = 2.4145;
-    const int rescale = 2;
-    const double rescaled_um2px_r = um2px_r / rescale;
-    double mk_xi_um = 0            ;
-    double mk_yi_um = 0            ;
-    int mk_w_d_um   = 405 * rescale;
-    int mk_h_d_um   = 405 * rescale;
-    int mk_w_um     = 50  * rescale;
-    int mk_h_um     = 50  * rescale;
-    int cl_w_um     = 4   * rescale;
-    int cl_h_um     = 4   * rescale;
-    int sp_w_um     = 1   * rescale;
-    int sp_h_um     = 1   * rescale;
-    int cl_wd_um    = cl_w_um + sp_w_um;
-    int cl_hd_um    = cl_h_um + sp_h_um;
-    int cl_wn       = 172;
-    int cl_hn       = 172;
-    double win_r    = 0.6;
+namespace {
+const double um2px_r = 2.4145;
+const int rescale = 2;
+const double rescaled_um2px_r = um2px_r / rescale;
+double mk_xi_um = 0            ;
+double mk_yi_um = 0            ;
+int mk_w_d_um   = 405 * rescale;
+int mk_h_d_um   = 405 * rescale;
+int mk_w_um     = 50  * rescale;
+int mk_h_um     = 50  * rescale;
+int cl_w_um     = 4   * rescale;
+int cl_h_um     = 4   * rescale;
+int sp_w_um     = 1   * rescale;
+int sp_h_um     = 1   * rescale;
+int cl_wd_um    = cl_w_um + sp_w_um;
+int cl_hd_um    = cl_h_um + sp_h_um;
+int cl_wn       = 172;
+int cl_hn       = 172;
+double win_r    = 0.6;
 
+/*
+ *  The probe channel image (CV_32F) and its probe warp matrix, from the
+ *  ArUco markers of the white channel and the probe marker bias.
+ */
+struct ProbeChannel {
+    cv::Mat img;
+    cv::Mat trans_mat;
+};
+ProbeChannel make_probe_channel() {
     auto pb_mk_path = nucleona::test::data_dir() / "banff_rc" / "pat_CY5.tsv";
     auto db_path = nucleona::test::data_dir() / "aruco_db.json";
     auto img0_path = nucleona::test::data_dir() / "aruco-green-pair" / "0-1-BF.tiff"; // in focus
@@ -51,14 +60,6 @@ TEST(warped_mat_test, basic_test) {
             aruco_ids_map[std::to_string(key)] = {x, y};
         }
     }
-    std::vector<cv::Point> aruco_points(53);
-    for(int y = 0; y < 7; y ++ ) {
-        for(int x = 0; x < 7; x ++ ) {
-            aruco_points[
-                aruco_ids_in_image[y * 7 + x] 
-            ] = cv::Point(x, y);
-        }
-    }
     auto [templ, mask] = aruco::create_location_marker(
         50, 40, 3, 5, um2px_r
     );
@@ -112,14 +113,32 @@ TEST(warped_mat_test, basic_test) {
             mat(1, 2) += _bias.y;
         });
     }
-
-    std::vector<cv::Point2d> img_px_pos;
-    for(auto&& p : px_pos) {
-        img_px_pos.push_back(p + bias);
-    }
     chipimgproc::ip_convert(img1, CV_32F);
+    return {img1, probe_trans_mat};
+}
+/*
+ *  The marker detection is shared by all the test cases, it runs once.
+ */
+const ProbeChannel& probe_channel() {
+    static const ProbeChannel pc = make_probe_channel();
+    return pc;
+}
+auto make_stat_args(const ProbeChannel& pc) {
+    return std::make_tuple(
+        pc.img, cv::Point2d(mk_xi_um, mk_yi_um),
+        cl_w_um, cl_h_um, cl_wd_um, cl_hd_um,
+        cl_wn * cl_wd_um, cl_hn * cl_hd_um,
+        cl_w_um * win_r, cl_h_um * win_r,
+        rescaled_um2px_r, 16383.0,
+        cl_wn, cl_hn, pc.trans_mat
+    );
+}
+}
+
+TEST(warped_mat_test, basic_test) {
+    auto& pc = probe_channel();
     auto warped_mat = make_warped_mat(
-        probe_trans_mat, img1, 
+        pc.trans_mat, pc.img, 
         {mk_xi_um, mk_yi_um},
         cl_w_um, cl_h_um,
         cl_wd_um, cl_hd_um,
@@ -159,5 +178,187 @@ TEST(warped_mat_test, basic_test) {
             EXPECT_EQ(ans[(i * 10) + j] * 255, first_marker(i, j));
         }
     }
+}
+
+TEST(warped_mat_test, parallel_extraction) {
+    // row-blocked parallel extraction must be identical to the serial one
+    auto stat_args = make_stat_args(probe_channel());
+    warped_mat::MakeStatMat<float> make_stat_mat;
+    auto [serial_stat, serial_info] = std::apply(make_stat_mat, stat_args);
+    make_stat_mat.set_thread_num(4);
+    auto [para_stat, para_info] = std::apply(make_stat_mat, stat_args);
+    EXPECT_EQ(cv::countNonZero(serial_stat.mean   != para_stat.mean  ), 0);
+    EXPECT_EQ(cv::countNonZero(serial_stat.stddev != para_stat.stddev), 0);
+    EXPECT_EQ(cv::countNonZero(serial_stat.cv     != para_stat.cv    ), 0);
+    for(int i = 0; i < cl_hn; i ++) {
+        for(int j = 0; j < cl_wn; j ++) {
+            EXPECT_EQ(serial_stat.min_cv_pos(i, j), para_stat.min_cv_pos(i, j));
+            EXPECT_EQ(serial_info(i, j).img_p, para_info(i, j).img_p);
+        }
+    }
+}
+
+TEST(warped_mat_test, whole_fov_stat) {
+    // whole FOV statistics mode, at the same window position the mean equals the 
+    // box mean of the per-probe patch up to float rounding, except the windows 
+    // reflected at the patch border or covering truncated pixels
+    auto& pc = probe_channel();
+    auto stat_args = make_stat_args(pc);
+    warped_mat::MakeStatMat<float> make_stat_mat;
+    auto [serial_stat, serial_info] = std::apply(make_stat_mat, stat_args);
+    make_stat_mat.set_whole_fov_stat(true);
+    auto [fov_stat, fov_info] = std::apply(make_stat_mat, stat_args);
+
+    const int swin_w_px = std::round(cl_w_um * win_r * rescaled_um2px_r);
+    const int swin_h_px = std::round(cl_h_um * win_r * rescaled_um2px_r);
+    const double theor_max_val = 16383.0;
+    // float rounding of a swin_w_px * swin_h_px box sum and the bilinear weights
+    const double tol = (swin_w_px * swin_h_px + 8) * FLT_EPSILON * theor_max_val;
+    int compared = 0;
+    for(int i = 0; i < cl_hn; i ++) {
+        for(int j = 0; j < cl_wn; j ++) {
+            auto& patch = serial_info(i, j).patch;
+            auto& img_p = serial_info(i, j).img_p;
+            EXPECT_EQ(img_p, fov_info(i, j).img_p);
+            cv::Point p = fov_stat.min_cv_pos(i, j);
+            cv::Rect wnd(p.x - swin_w_px / 2, p.y - swin_h_px / 2, swin_w_px, swin_h_px);
+            if((wnd & cv::Rect(0, 0, patch.cols, patch.rows)) != wnd) continue;
+            // the image pixels interpolated into the window
+            cv::Rect src_wnd(
+                std::floor(img_p.x - (patch.cols - 1) * 0.5) + wnd.x,
+                std::floor(img_p.y - (patch.rows - 1) * 0.5) + wnd.y,
+                wnd.width + 1, wnd.height + 1
+            );
+            double src_max;
+            cv::minMaxLoc(pc.img(src_wnd), nullptr, &src_max);
+            if(src_max > theor_max_val) continue;
+            auto ref = cv::mean(patch(wnd))[0];
+            EXPECT_NEAR(fov_stat.mean(i, j), ref, tol) << "probe (" << i << "," << j << ")";
+            compared ++;
+        }
+    }
+    EXPECT_GT(compared, 0.5 * cl_hn * cl_wn);
+}
+
+TEST(warped_mat_test, analytic_label) {
+    // analytic probe labels must select the same pure regions as connectedComponents
+    auto stat_args = make_stat_args(probe_channel());
+    warped_mat::MakeStatMat<float> make_stat_mat;
+    auto [serial_stat, serial_info] = std::apply(make_stat_mat, stat_args);
+    make_stat_mat.set_analytic_label(true);
+    auto [ana_stat, ana_info] = std::apply(make_stat_mat, stat_args);
+    EXPECT_EQ(cv::countNonZero(serial_stat.mean != ana_stat.mean), 0);
+    EXPECT_EQ(cv::countNonZero(serial_stat.cv   != ana_stat.cv  ), 0);
+}
 
-}
\ No newline at end of file
+TEST(warped_mat_test, large_mask_cache) {
+    // the large mask cache shifts the cached mask for an integer translated warp,
+    // the fixed point rasterization of this warp is translation invariant, so the
+    // shifted mask must be exactly the rebuilt one
+    const double scale = 1.25;
+    cv::Mat_<double> grid_warp = (cv::Mat_<double>(2, 3) << 
+        scale, 0, 200, 
+        0, scale, 200
+    );
+    auto grid_args = make_stat_args(probe_channel());
+    std::get<10>(grid_args) = scale;
+    std::get<14>(grid_args) = grid_warp;
+    auto shifted_args = grid_args;
+    cv::Mat_<double> shifted_warp = grid_warp.clone();
+    shifted_warp(0, 2) += 5;
+    shifted_warp(1, 2) += 5;
+    std::get<14>(shifted_args) = shifted_warp;
+    warped_mat::MakeStatMat<float> make_stat_mat;
+    auto [ref_stat, ref_info] = std::apply(make_stat_mat, shifted_args);
+
+    auto cache = std::make_shared<warped_mat::LargeMaskCache>();
+    make_stat_mat.set_large_mask_cache(cache);
+    std::apply(make_stat_mat, grid_args);
+    auto [cached_stat, cached_info] = std::apply(make_stat_mat, shifted_args);
+    EXPECT_EQ(cache->misses(), 1u);
+    EXPECT_EQ(cache->hits(), 1u);
+    EXPECT_EQ(cv::countNonZero(ref_stat.mean   != cached_stat.mean  ), 0);
+    EXPECT_EQ(cv::countNonZero(ref_stat.stddev != cached_stat.stddev), 0);
+    EXPECT_EQ(cv::countNonZero(ref_stat.cv     != cached_stat.cv    ), 0);
+    for(int i = 0; i < cl_hn; i ++) {
+        for(int j = 0; j < cl_wn; j ++) {
+            EXPECT_EQ(ref_stat.min_cv_pos(i, j), cached_stat.min_cv_pos(i, j));
+        }
+    }
+
+    // the probe grid within the filter border of the image edge is rebuilt
+    auto edge_args = grid_args;
+    cv::Mat_<double> edge_warp = grid_warp.clone();
+    edge_warp(0, 2) = 2;
+    std::get<14>(edge_args) = edge_warp;
+    std::apply(make_stat_mat, edge_args);
+    EXPECT_EQ(cache->misses(), 2u);
+    EXPECT_EQ(cache->hits(), 1u);
+}
+
+TEST(warped_mat_test, grid_remap) {
+    // grid remap mode only differs by the quantized interpolation weights
+    auto stat_args = make_stat_args(probe_channel());
+    warped_mat::MakeStatMat<float> make_stat_mat;
+    auto [serial_stat, serial_info] = std::apply(make_stat_mat, stat_args);
+    make_stat_mat.set_grid_remap(true);
+    auto [remap_stat, remap_info] = std::apply(make_stat_mat, stat_args);
+    int agree_num = 0;
+    for(int i = 0; i < cl_hn; i ++) {
+        for(int j = 0; j < cl_wn; j ++) {
+            EXPECT_EQ(serial_info(i, j).img_p, remap_info(i, j).img_p);
+            auto diff = std::abs(remap_stat.mean(i, j) - serial_stat.mean(i, j));
+            if(diff <= 0.01 * serial_stat.mean(i, j)) agree_num ++;
+        }
+    }
+    EXPECT_GT(agree_num, 0.99 * cl_hn * cl_wn);
+}
+
+TEST(warped_mat_test, multi_channel) {
+    // every channel of the multi-channel extraction equals the single channel one
+    auto& pc = probe_channel();
+    warped_mat::MakeStatMat<float> make_stat_mat;
+    auto [serial_stat, serial_info] = std::apply(make_stat_mat, make_stat_args(pc));
+    auto [multi_stat, multi_info] = make_stat_mat(
+        std::vector<cv::Mat>{pc.img, pc.img.clone()}, cv::Point2d(mk_xi_um, mk_yi_um),
+        cl_w_um, cl_h_um, cl_wd_um, cl_hd_um,
+        cl_wn * cl_wd_um, cl_hn * cl_hd_um,
+        cl_w_um * win_r, cl_h_um * win_r,
+        rescaled_um2px_r, 16383.0,
+        cl_wn, cl_hn, pc.trans_mat
+    );
+    ASSERT_EQ(multi_stat.size(), 2u);
+    ASSERT_EQ(multi_info.size(), 2u);
+    for(std::size_t ch = 0; ch < multi_stat.size(); ch ++) {
+        EXPECT_EQ(cv::countNonZero(serial_stat.mean != multi_stat[ch].mean), 0);
+        EXPECT_EQ(cv::countNonZero(serial_stat.cv   != multi_stat[ch].cv  ), 0);
+        for(int i = 0; i < cl_hn; i ++) {
+            for(int j = 0; j < cl_wn; j ++) {
+                EXPECT_EQ(serial_info(i, j).img_p, multi_info[ch](i, j).img_p);
+            }
+        }
+    }
+}
+
+TEST(warped_mat_test, patch_storage) {
+    // slab storage keeps the same patches, none storage keeps only the positions
+    auto stat_args = make_stat_args(probe_channel());
+    warped_mat::MakeStatMat<float> make_stat_mat;
+    auto [serial_stat, serial_info] = std::apply(make_stat_mat, stat_args);
+    make_stat_mat.set_patch_storage(warped_mat::PatchStorage::slab);
+    auto [slab_stat, slab_info] = std::apply(make_stat_mat, stat_args);
+    make_stat_mat.set_patch_storage(warped_mat::PatchStorage::none);
+    auto [none_stat, none_info] = std::apply(make_stat_mat, stat_args);
+    EXPECT_EQ(cv::countNonZero(serial_stat.mean != slab_stat.mean), 0);
+    EXPECT_EQ(cv::countNonZero(serial_stat.mean != none_stat.mean), 0);
+    auto* slab_begin = slab_info(0, 0).patch.datastart;
+    for(int i = 0; i < cl_hn; i ++) {
+        for(int j = 0; j < cl_wn; j ++) {
+            auto& patch = slab_info(i, j).patch;
+            EXPECT_EQ(patch.datastart, slab_begin);
+            EXPECT_EQ(cv::norm(patch, serial_info(i, j).patch, cv::NORM_INF), 0);
+            EXPECT_TRUE(none_info(i, j).patch.empty());
+            EXPECT_EQ(none_info(i, j).img_p, serial_info(i, j).img_p);
+        }
+    }
+}